@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    Benchmark.h
+    Created: 19 Oct 2026 3:12:40pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+using namespace juce;
+
+/**
+ * A named measurement that is run by the benchmarks app.
+ *
+ * Like JUCE's `UnitTest`, benchmarks register themselves when constructed, so
+ * a benchmark is added by declaring a static instance of its subclass.
+ */
+class Benchmark {
+public:
+  explicit Benchmark(const String &name) : name(name) {
+    getAllBenchmarks().push_back(this);
+  }
+
+  virtual ~Benchmark() {
+    auto &benchmarks = getAllBenchmarks();
+    benchmarks.erase(std::remove(benchmarks.begin(), benchmarks.end(), this),
+                     benchmarks.end());
+  }
+
+  virtual void run() = 0;
+
+  const String &getName() const { return name; }
+
+  static std::vector<Benchmark *> &getAllBenchmarks() {
+    static std::vector<Benchmark *> benchmarks;
+    return benchmarks;
+  }
+
+#pragma mark - Measuring
+
+  /** Times of the iterations of a measurement, in microseconds. */
+  struct Statistics {
+    double mean = 0;
+    double median = 0;
+    double p99 = 0;
+    double max = 0;
+  };
+
+  /** Calls `fn` `iterations` times, after a few warm-up calls. */
+  template <typename Function>
+  static Statistics measure(int iterations, Function &&fn) {
+    return measure(iterations, std::forward<Function>(fn), [] {});
+  }
+
+  /** Like `measure()`, but calls `setUp` before every call, untimed. */
+  template <typename Function, typename SetUp>
+  static Statistics measure(int iterations, Function &&fn, SetUp &&setUp) {
+    for (auto i = 0; i < std::min(iterations, 3); i++) {
+      setUp();
+      fn();
+    }
+
+    std::vector<double> times((size_t)iterations);
+
+    for (auto &time : times) {
+      setUp();
+
+      const auto start = Time::getHighResolutionTicks();
+      fn();
+      const auto end = Time::getHighResolutionTicks();
+
+      time = Time::highResolutionTicksToSeconds(end - start) * 1.0e6;
+    }
+
+    std::sort(times.begin(), times.end());
+
+    Statistics statistics;
+    for (auto time : times)
+      statistics.mean += time / iterations;
+
+    statistics.median = times[times.size() / 2];
+    statistics.p99 = times[std::min(times.size() - 1, times.size() * 99 / 100)];
+    statistics.max = times.back();
+
+    return statistics;
+  }
+
+  /**
+   * Prints the statistics of a measurement. When `itemsPerIteration` is
+   * given, the mean time is also printed per item, in nanoseconds.
+   */
+  static void report(const String &label, const Statistics &statistics,
+                     double itemsPerIteration = 0,
+                     const String &itemName = "sample") {
+    std::cout << "  " << std::left << std::setw(44) << label << std::right
+              << std::fixed << std::setprecision(2) << " mean "
+              << std::setw(10) << statistics.mean << " us, median "
+              << std::setw(10) << statistics.median << " us, p99 "
+              << std::setw(10) << statistics.p99 << " us";
+
+    if (itemsPerIteration > 0)
+      std::cout << ", " << std::setprecision(3)
+                << statistics.mean * 1000.0 / itemsPerIteration << " ns/"
+                << itemName;
+
+    std::cout << std::endl;
+  }
+
+  static void report(const String &label, double value, const String &unit) {
+    std::cout << "  " << std::left << std::setw(44) << label << std::right
+              << " " << std::setprecision(4) << value << " " << unit
+              << std::endl;
+  }
+
+  /** Keeps the compiler from optimizing away a computed value. */
+  template <typename T> static void keep(const T &value) {
+    static volatile T sink;
+    sink = value;
+  }
+
+private:
+  String name;
+
+  JUCE_DECLARE_NON_COPYABLE(Benchmark)
+};
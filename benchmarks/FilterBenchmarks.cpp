@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    FilterBenchmarks.cpp
+    Created: 19 Oct 2026 8:14:37pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "SynthFixture.h"
+
+/**
+ * Measures the ladder filter with a static cutoff and with a cutoff that is
+ * modulated at every control update, both for a single filter and for the
+ * voices of a synth.
+ */
+class FilterModulationBenchmark : public Benchmark {
+public:
+  FilterModulationBenchmark() : Benchmark("Filter Modulation") {}
+
+  static constexpr auto sampleRate = 48000.0;
+  static constexpr auto controlBlockSize = 48;
+  static constexpr auto numberOfControlBlocks = 10;
+
+  void run() override {
+    LadderFilterCutoffTable cutoffTable;
+    cutoffTable.prepare(sampleRate, Synth::minCutoff, Synth::maxCutoff);
+
+    std::vector<float> samples(controlBlockSize);
+    Random random(1);
+
+    for (auto &sample : samples)
+      sample = random.nextFloat() * 2 - 1;
+
+    // A 1 kHz control rate, like the voices' at 48 kHz.
+    auto measureFilter = [&](const String &label, bool usesTable,
+                             auto &&cutoffForUpdate) {
+      LadderFilter filter;
+      filter.setCutoffTable(usesTable ? &cutoffTable : nullptr);
+      filter.prepare({sampleRate, (uint32_t)controlBlockSize, 1});
+
+      auto update = 0;
+
+      report(label, measure(2000, [&] {
+               for (auto i = 0; i < numberOfControlBlocks; i++, update++) {
+                 if (auto cutoff = cutoffForUpdate(update); cutoff > 0) {
+                   filter.setCutoffFrequencyHz(cutoff);
+                   filter.setResonance(0.5f);
+                 }
+
+                 filter.process(samples.data(), (size_t)controlBlockSize);
+               }
+
+               keep(samples.back());
+             }),
+             controlBlockSize * numberOfControlBlocks);
+    };
+
+    auto modulatedCutoff = [](int update) {
+      return 200.0f + 9000.0f * (0.5f + 0.5f * std::sin(0.05f * update));
+    };
+
+    measureFilter("Filter, static, update skipped", true,
+                  [](int) { return 0.0f; });
+    measureFilter("Filter, static, updated", true,
+                  [](int) { return 1000.0f; });
+    measureFilter("Filter, modulated, cutoff table", true, modulatedCutoff);
+    measureFilter("Filter, modulated, exp per update", false,
+                  modulatedCutoff);
+
+    for (auto modulated : {false, true}) {
+      constexpr auto numberOfVoices = 16;
+
+      SynthFixture fixture(numberOfVoices);
+
+      // A decay that sweeps the cutoff for a whole second.
+      if (modulated) {
+        fixture.setParameter(SynthFixture::Field::CutoffEnvelopeAmount, 1);
+        fixture.setParameter(SynthFixture::Field::Decay, 1);
+        fixture.setParameter(SynthFixture::Field::Sustain, 0);
+      } else {
+        fixture.setParameter(SynthFixture::Field::CutoffEnvelopeAmount, 0);
+      }
+
+      const auto statistics = fixture.measureHeldChord(numberOfVoices, 80);
+
+      report(String(numberOfVoices) +
+                 (modulated ? " voices, cutoff decaying" : " voices, static"),
+             statistics, (double)fixture.getBlockSize() * numberOfVoices,
+             "voice sample");
+    }
+  }
+};
+
+static FilterModulationBenchmark filterModulationBenchmark;
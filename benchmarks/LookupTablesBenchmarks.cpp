@@ -0,0 +1,261 @@
+/*
+  ==============================================================================
+
+    LookupTablesBenchmarks.cpp
+    Created: 19 Oct 2026 3:12:40pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+#include "LookupTablesBank.h"
+#include "VCAOscillator.h"
+
+#include <array>
+
+/**
+ * The tables the bank was built from before it used the inverse FFT: ten
+ * frequency bands of `dsp::LookupTableTransform`, each summing its sine
+ * series at every point, and picked by a linear scan of the bands.
+ */
+class AdditiveLookupTables {
+public:
+  static constexpr auto tableResolution = 1024;
+  static constexpr auto pi = MathConstants<float>::pi;
+
+  static constexpr std::array<float, 10> bandMaxFrequencies{
+      60, 250, 500, 1000, 2000, 3000, 4000, 5000, 6000, 20000};
+
+  enum Waveform { Saw, Square, NumberOfWaveForms };
+
+  explicit AdditiveLookupTables(double sampleRate) {
+    const auto nyquistFrequency = 0.5 * sampleRate;
+
+    for (auto band = 0; band < (int)bandMaxFrequencies.size(); band++) {
+      const auto ratio = nyquistFrequency / bandMaxFrequencies[band];
+      const auto sawOrder = std::max(1, (int)ratio);
+      const auto squareOrder = std::max(1, (int)(0.5 * (ratio + 1)));
+
+      tables[Saw][band].initialise(
+          [=](float value) { return sineSeries(sawOrder, 1, value); }, -pi,
+          pi, tableResolution);
+
+      tables[Square][band].initialise(
+          [=](float value) { return sineSeries(squareOrder, 2, value); }, -pi,
+          pi, tableResolution);
+    }
+  }
+
+  float operator()(float phase, Waveform waveform, float frequency) const {
+    return tables[waveform][bandForFrequency(frequency)](phase);
+  }
+
+  static int bandForFrequency(float frequency) {
+    for (auto band = 0; band < (int)bandMaxFrequencies.size(); band++) {
+      if (frequency < bandMaxFrequencies[band])
+        return band;
+    }
+
+    return (int)bandMaxFrequencies.size() - 1;
+  }
+
+private:
+  std::array<std::array<dsp::LookupTableTransform<float>,
+                        bandMaxFrequencies.size()>,
+             NumberOfWaveForms>
+      tables;
+
+  /** Sums the partials `1, 1 + step, 1 + 2 * step, ...` of the series. */
+  static float sineSeries(int order, int step, float value) {
+    auto result = 0.0f;
+
+    for (auto k = 1; k <= order; k++) {
+      const auto kFactor = float(step * k - (step - 1));
+      result += std::sin(kFactor * value) / kFactor;
+    }
+
+    return result;
+  }
+};
+
+/**
+ * Compares building the bank's tables with the inverse FFT against summing
+ * the sine series of the additive tables, and the cost of a lookup in each.
+ */
+class LookupTablesBenchmark : public Benchmark {
+public:
+  LookupTablesBenchmark() : Benchmark("Lookup Tables") {}
+
+  static constexpr auto sampleRate = 48000.0;
+
+  void run() override {
+    using Bank = LookupTablesBank<float>;
+
+    report("Build, inverse FFT (saw, square)", measure(20, [] {
+             Bank bank;
+             bank.initialize(sampleRate);
+             keep(bank.tableSamples()[1]);
+           }));
+
+    report("Build, additive series (saw, square)", measure(5, [] {
+             AdditiveLookupTables tables(sampleRate);
+             keep(tables(0.5f, AdditiveLookupTables::Saw, 100.0f));
+           }));
+
+    Bank bank;
+    bank.initialize(sampleRate);
+    const AdditiveLookupTables additiveTables(sampleRate);
+
+    // A saw sweeping the audible range, so every octave and band is read.
+    constexpr auto numberOfSamples = 1 << 16;
+
+    report("Lookup, octave tables", measure(50, [&] {
+             sweep(numberOfSamples, [&](float phase, float frequency) {
+               return bank(phase, Bank::Saw, frequency);
+             });
+           }),
+           numberOfSamples);
+
+    report("Lookup, additive bands", measure(50, [&] {
+             sweep(numberOfSamples, [&](float phase, float frequency) {
+               return additiveTables(phase, AdditiveLookupTables::Saw,
+                                     frequency);
+             });
+           }),
+           numberOfSamples);
+  }
+
+private:
+  template <typename Lookup>
+  static void sweep(int numberOfSamples, Lookup &&lookup) {
+    constexpr auto pi = MathConstants<float>::pi;
+
+    auto phase = 0.0f;
+    auto sum = 0.0f;
+
+    for (auto i = 0; i < numberOfSamples; i++) {
+      const auto frequency = 20.0f * std::exp2(10.0f * i / numberOfSamples);
+
+      sum += lookup(phase, frequency);
+
+      phase += 2 * pi * frequency / (float)sampleRate;
+      if (phase >= pi)
+        phase -= 2 * pi;
+    }
+
+    keep(sum);
+  }
+};
+
+static LookupTablesBenchmark lookupTablesBenchmark;
+
+/**
+ * Compares resolving the table for a frequency by scanning the additive
+ * tables' bands, with the octave tables' constant-time resolution, and the
+ * cost per sample of a steady note when the table is resolved for every
+ * sample, or once by the oscillator when its frequency is set.
+ */
+class BandSelectionBenchmark : public Benchmark {
+public:
+  BandSelectionBenchmark() : Benchmark("Band Selection") {}
+
+  static constexpr auto sampleRate = 48000.0;
+  static constexpr auto blockSize = 512;
+
+  void run() override {
+    using Bank = LookupTablesBank<float>;
+
+    std::vector<float> frequencies(4096);
+    Random random(1);
+
+    for (auto &frequency : frequencies)
+      frequency = 20.0f * std::exp2(10.0f * random.nextFloat());
+
+    report("Resolve, linear band scan", measure(1000, [&] {
+             auto sum = 0;
+             for (auto frequency : frequencies)
+               sum += AdditiveLookupTables::bandForFrequency(frequency);
+             keep(sum);
+           }),
+           (double)frequencies.size(), "frequency");
+
+    report("Resolve, octave from exponent bits", measure(1000, [&] {
+             auto sum = 0.0f;
+             for (auto frequency : frequencies) {
+               int octave;
+               float crossfade;
+               Bank::LookupTable::octaveForFrequency(frequency, octave,
+                                                     crossfade);
+               sum += octave + crossfade;
+             }
+             keep(sum);
+           }),
+           (double)frequencies.size(), "frequency");
+
+    Bank bank;
+    bank.initialize(sampleRate);
+    const AdditiveLookupTables additiveTables(sampleRate);
+
+    constexpr auto frequency = 440.0f;
+    constexpr auto pi = MathConstants<float>::pi;
+    constexpr auto phaseIncrement = 2 * pi * frequency / (float)sampleRate;
+
+    // Read for every sample, like the oscillator's frequency used to be, so
+    // the compiler can't resolve the table once for the whole block.
+    volatile auto noteFrequency = frequency;
+
+    std::vector<float> samples(blockSize);
+
+    auto renderPerSample = [&](auto &&lookup) {
+      auto phase = -pi;
+
+      for (auto &sample : samples) {
+        sample = lookup(phase, noteFrequency);
+
+        phase += phaseIncrement;
+        if (phase >= pi)
+          phase -= 2 * pi;
+      }
+
+      keep(samples.back());
+    };
+
+    report("A4, band scanned every sample", measure(2000, [&] {
+             renderPerSample([&](float phase, float frequency) {
+               return additiveTables(phase, AdditiveLookupTables::Saw,
+                                     frequency);
+             });
+           }),
+           blockSize);
+
+    report("A4, octave resolved every sample", measure(2000, [&] {
+             renderPerSample([&](float phase, float frequency) {
+               return bank(phase, Bank::Saw, frequency);
+             });
+           }),
+           blockSize);
+
+    VCAOscillator<float> oscillator;
+    oscillator.initialize(&bank);
+    oscillator.setWaveform(Bank::Saw);
+    oscillator.prepare({sampleRate, (uint32_t)blockSize, 1});
+    oscillator.setFrequency(frequency);
+    oscillator.setLevel(1);
+    oscillator.reset();
+
+    report("A4, octave resolved by the oscillator", measure(2000, [&] {
+             FloatVectorOperations::clear(samples.data(), blockSize);
+
+             float *channels[] = {samples.data()};
+             dsp::AudioBlock<float> block(channels, 1, (size_t)blockSize);
+             oscillator.process(dsp::ProcessContextReplacing<float>(block));
+
+             keep(samples.back());
+           }),
+           blockSize);
+  }
+};
+
+static BandSelectionBenchmark bandSelectionBenchmark;
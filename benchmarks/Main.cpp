@@ -0,0 +1,35 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 19 Oct 2026 3:12:40pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+#include <juce_events/juce_events.h>
+
+/**
+ * Runs the benchmarks whose names contain the first argument, or all of them
+ * when no argument is given.
+ */
+int main(int argc, char *argv[]) {
+  // The synth's release pool uses a timer, which needs a message manager.
+  ScopedJuceInitialiser_GUI juceInitialiser;
+
+  const auto filter = argc > 1 ? String(argv[1]) : String();
+
+  for (auto *benchmark : Benchmark::getAllBenchmarks()) {
+    if (!benchmark->getName().containsIgnoreCase(filter))
+      continue;
+
+    std::cout << benchmark->getName() << std::endl;
+    benchmark->run();
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
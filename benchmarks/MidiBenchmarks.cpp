@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    MidiBenchmarks.cpp
+    Created: 19 Oct 2026 9:02:11pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "SynthFixture.h"
+
+/**
+ * Measures the distribution of block times while the synth is flooded with
+ * notes, and compares it with the same voices held without any MIDI.
+ */
+class MidiStormBenchmark : public Benchmark {
+public:
+  MidiStormBenchmark() : Benchmark("MIDI Storm") {}
+
+  static constexpr auto numberOfVoices = 16;
+  static constexpr auto numberOfBlocks = 2000;
+
+  void run() override {
+    SynthFixture fixture(numberOfVoices);
+    fixture.getSynth().setNoteStealingEnabled(true);
+
+    report("16 voices held, no MIDI",
+           fixture.measureHeldChord(numberOfVoices, numberOfBlocks));
+
+    for (auto notesPerBlock : {16, 64, 256}) {
+      const auto storm = makeNoteStorm(notesPerBlock, fixture.getBlockSize());
+
+      report("16 voices, " + String(notesPerBlock) + " notes per block",
+             fixture.measureBlocks(numberOfBlocks, storm));
+    }
+  }
+
+private:
+  /**
+   * Blocks of note-ons and note-offs of random notes, on random channels and
+   * at random positions, so voices are stolen and released all the time.
+   */
+  static std::vector<MidiBuffer> makeNoteStorm(int notesPerBlock,
+                                               int blockSize) {
+    std::vector<MidiBuffer> blocks(64);
+    Random random(notesPerBlock);
+
+    for (auto &block : blocks) {
+      for (auto i = 0; i < notesPerBlock; i++) {
+        const auto channel = 1 + random.nextInt(16);
+        const auto note = 24 + random.nextInt(72);
+        const auto position = random.nextInt(blockSize);
+
+        if (random.nextBool())
+          block.addEvent(MidiMessage::noteOn(channel, note, (uint8)100),
+                         position);
+        else
+          block.addEvent(MidiMessage::noteOff(channel, note), position);
+      }
+    }
+
+    return blocks;
+  }
+};
+
+static MidiStormBenchmark midiStormBenchmark;
+
+/**
+ * Measures the block times of held voices under a stream of mod wheel and
+ * pitch wheel messages every few samples, with and without coalescing.
+ */
+class DenseControllerStreamBenchmark : public Benchmark {
+public:
+  DenseControllerStreamBenchmark() : Benchmark("Dense Controller Stream") {}
+
+  static constexpr auto numberOfVoices = 16;
+  static constexpr auto numberOfBlocks = 1000;
+
+  void run() override {
+    for (auto interval : {16, 4, 1}) {
+      for (auto window : {0, Synth::defaultMidiCoalescingWindow}) {
+        SynthFixture fixture(numberOfVoices);
+        fixture.getSynth().setMidiCoalescingWindow(window);
+        fixture.prepare();
+        fixture.playChord(numberOfVoices);
+
+        const auto stream =
+            makeControllerStream(interval, fixture.getBlockSize());
+
+        const auto every =
+            interval == 1 ? String("every sample")
+                          : "every " + String(interval) + " samples";
+
+        report("Controllers " + every + ", " +
+                   (window == 0 ? "all handled" : "coalesced"),
+               fixture.measureBlocks(numberOfBlocks, {stream}));
+      }
+    }
+  }
+
+private:
+  /** A block with a mod wheel and a pitch wheel sweep, both on channel 1. */
+  static MidiBuffer makeControllerStream(int interval, int blockSize) {
+    MidiBuffer block;
+
+    for (auto position = 0; position < blockSize; position += interval) {
+      const auto phase = (float)position / (float)blockSize;
+
+      block.addEvent(MidiMessage::controllerEvent(1, 1, (int)(127 * phase)),
+                     position);
+      block.addEvent(
+          MidiMessage::pitchWheel(1, 0x2000 + (int)(0x1000 * phase)),
+          position);
+    }
+
+    return block;
+  }
+};
+
+static DenseControllerStreamBenchmark denseControllerStreamBenchmark;
@@ -0,0 +1,252 @@
+/*
+  ==============================================================================
+
+    OscillatorBenchmarks.cpp
+    Created: 19 Oct 2026 6:20:48pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+#include "VCAOscillator.h"
+
+/**
+ * Compares the wavetable and PolyBLEP engines of `VCAOscillator`: the time
+ * they take per sample, and how much aliasing they produce across the MIDI
+ * note range.
+ *
+ * Aliasing is the power of the spectrum outside the harmonics of the note,
+ * relative to the power of the harmonics.
+ */
+class OscillatorEnginesBenchmark : public Benchmark {
+public:
+  OscillatorEnginesBenchmark() : Benchmark("Oscillator Engines") {}
+
+  using Oscillator = VCAOscillator<float>;
+  using Bank = Oscillator::LookupTablesBank;
+
+  static constexpr auto sampleRate = 48000.0;
+  static constexpr auto blockSize = 512;
+
+  static constexpr auto fftOrder = 14;
+  static constexpr auto fftSize = 1 << fftOrder;
+
+  void run() override {
+    Bank bank;
+    bank.initialize(sampleRate);
+
+    std::vector<float> samples(blockSize);
+
+    for (auto engine : {Oscillator::Wavetable, Oscillator::PolyBLEP}) {
+      for (auto waveform : {Bank::Saw, Bank::Square}) {
+        const auto label = String(engineName(engine)) + ", " +
+                           (waveform == Bank::Saw ? "saw" : "square");
+
+        // Notes across the keyboard, so every octave table is read.
+        auto note = 0;
+
+        report(label, measure(2000, [&] {
+                 auto oscillator = makeOscillator(bank, engine, waveform,
+                                                  noteFrequency(note));
+                 render(oscillator, samples.data(), blockSize);
+                 note = (note + 7) % 128;
+               }),
+               blockSize);
+      }
+    }
+
+    std::cout << "  Aliasing of the saw, dB below the harmonics:" << std::endl;
+
+    for (auto note = 24; note <= 120; note += 12) {
+      std::cout << "    note " << std::setw(3) << note;
+
+      for (auto engine : {Oscillator::Wavetable, Oscillator::PolyBLEP}) {
+        std::cout << ", " << engineName(engine) << " " << std::setw(7)
+                  << std::setprecision(1)
+                  << aliasingDecibels(bank, engine, Bank::Saw,
+                                      noteFrequency(note));
+      }
+
+      std::cout << std::endl;
+    }
+  }
+
+private:
+  static const char *engineName(Oscillator::Engine engine) {
+    return engine == Oscillator::Wavetable ? "wavetable" : "PolyBLEP";
+  }
+
+  static double noteFrequency(int note) {
+    return MidiMessage::getMidiNoteInHertz(note);
+  }
+
+  static Oscillator makeOscillator(const Bank &bank, Oscillator::Engine engine,
+                                   Bank::Waveform waveform, double frequency) {
+    Oscillator oscillator;
+    oscillator.initialize(&bank);
+    oscillator.setEngine(engine);
+    oscillator.setWaveform(waveform);
+    oscillator.prepare({sampleRate, (uint32_t)blockSize, 1});
+    oscillator.setFrequency((float)frequency);
+    oscillator.setLevel(1);
+    oscillator.reset();
+
+    return oscillator;
+  }
+
+  static void render(Oscillator &oscillator, float *samples, int numSamples) {
+    FloatVectorOperations::clear(samples, numSamples);
+
+    float *channels[] = {samples};
+    dsp::AudioBlock<float> block(channels, 1, (size_t)numSamples);
+    oscillator.process(dsp::ProcessContextReplacing<float>(block));
+  }
+
+  static double aliasingDecibels(const Bank &bank, Oscillator::Engine engine,
+                                 Bank::Waveform waveform, double frequency) {
+    auto oscillator = makeOscillator(bank, engine, waveform, frequency);
+
+    std::vector<float> samples(2 * fftSize);
+    render(oscillator, samples.data(), fftSize);
+
+    // A 4-term Blackman-Harris window, whose sidelobes are below the
+    // aliasing of either engine.
+    for (auto i = 0; i < fftSize; i++) {
+      const auto x = MathConstants<double>::twoPi * i / fftSize;
+      samples[(size_t)i] *=
+          (float)(0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) -
+                  0.01168 * std::cos(3 * x));
+    }
+
+    dsp::FFT(fftOrder).performRealOnlyForwardTransform(samples.data());
+
+    const auto binWidth = sampleRate / fftSize;
+    constexpr auto windowHalfWidth = 4;
+
+    auto harmonicsPower = 0.0;
+    auto aliasingPower = 0.0;
+
+    for (auto bin = 1; bin < fftSize / 2; bin++) {
+      const auto re = (double)samples[(size_t)(2 * bin)];
+      const auto im = (double)samples[(size_t)(2 * bin + 1)];
+      const auto power = re * re + im * im;
+
+      const auto binFrequency = bin * binWidth;
+      const auto harmonic = std::round(binFrequency / frequency);
+
+      if (harmonic >= 1 && std::abs(binFrequency - harmonic * frequency) <=
+                               windowHalfWidth * binWidth)
+        harmonicsPower += power;
+      else
+        aliasingPower += power;
+    }
+
+    return 10 * std::log10(aliasingPower / harmonicsPower);
+  }
+};
+
+static OscillatorEnginesBenchmark oscillatorEnginesBenchmark;
+
+/**
+ * Compares rendering a voice's two PolyBLEP oscillators one after the other
+ * with rendering them in one pass, with `VCAOscillator::processPair()`, in
+ * 1 ms control blocks like a voice. Also checks that both give the same
+ * output. The oscillators' levels change every block, and their gain ramps
+ * end at different samples, so every way of splitting a block is rendered.
+ */
+class OscillatorPairBenchmark : public Benchmark {
+public:
+  OscillatorPairBenchmark() : Benchmark("Oscillator Pair") {}
+
+  using Oscillator = VCAOscillator<float>;
+
+  static constexpr auto sampleRate = 48000.0;
+  static constexpr auto blockSize = 48;
+  static constexpr auto numberOfBlocks = 200;
+
+  void run() override {
+    for (auto position : {0.5f, 1.5f}) {
+      const auto waveforms =
+          String(position < 1 ? "sine to saw" : "saw to square");
+
+      for (auto inOnePass : {false, true}) {
+        auto pair = OscillatorPair(position);
+        std::vector<float> samples(blockSize);
+
+        report(waveforms + (inOnePass ? ", one pass" : ", one by one"),
+               measure(200,
+                       [&] {
+                         for (auto block = 0; block < numberOfBlocks; block++)
+                           pair.render(samples.data(), block, inOnePass);
+
+                         keep(samples.back());
+                       }),
+               numberOfBlocks * blockSize);
+      }
+
+      report(waveforms + ", differing",
+             (double)countDifferingSamples(position), "samples");
+    }
+  }
+
+private:
+  struct OscillatorPair {
+    Oscillator first, second;
+
+    explicit OscillatorPair(float position) {
+      first.setRampDurationSeconds(0.5 * blockSize / sampleRate);
+      second.setRampDurationSeconds(1.5 * blockSize / sampleRate);
+
+      for (auto *oscillator : {&first, &second}) {
+        oscillator->initialize(nullptr);
+        oscillator->setEngine(Oscillator::PolyBLEP);
+        oscillator->setWaveformPosition(position);
+        oscillator->prepare({sampleRate, (uint32_t)blockSize, 1});
+      }
+
+      first.setFrequency(220);
+      second.setFrequency(220.7f);
+    }
+
+    void render(float *samples, int block, bool inOnePass) {
+      first.setLevel(0.5f + 0.25f * (float)(block % 3));
+      second.setLevel(1.0f - 0.2f * (float)(block % 4));
+
+      FloatVectorOperations::clear(samples, blockSize);
+
+      float *channels[] = {samples};
+      dsp::AudioBlock<float> audioBlock(channels, 1, (size_t)blockSize);
+      const dsp::ProcessContextReplacing<float> context(audioBlock);
+
+      if (inOnePass) {
+        Oscillator::processPair(first, second, context);
+      } else {
+        first.process(context);
+        second.process(context);
+      }
+    }
+  };
+
+  static int countDifferingSamples(float position) {
+    auto oneByOne = OscillatorPair(position);
+    auto onePass = OscillatorPair(position);
+
+    std::vector<float> oneByOneSamples(blockSize), onePassSamples(blockSize);
+    auto differingSamples = 0;
+
+    for (auto block = 0; block < numberOfBlocks; block++) {
+      oneByOne.render(oneByOneSamples.data(), block, false);
+      onePass.render(onePassSamples.data(), block, true);
+
+      for (auto i = 0; i < blockSize; i++)
+        if (oneByOneSamples[(size_t)i] != onePassSamples[(size_t)i])
+          differingSamples++;
+    }
+
+    return differingSamples;
+  }
+};
+
+static OscillatorPairBenchmark oscillatorPairBenchmark;
@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+
+    PrepareBenchmarks.cpp
+    Created: 19 Oct 2026 5:03:21pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#include <set>
+
+#include "Benchmark.h"
+#include "SynthFixture.h"
+
+/**
+ * Compares preparing a synth whose lookup tables have to be built (cold),
+ * with one that memory-maps them from the cache (warm), and with one that
+ * attaches to the tables of another instance.
+ *
+ * The synth waits for its tables, like in offline renders, so that the cold
+ * prepare includes the build.
+ */
+class PrepareBenchmark : public Benchmark {
+public:
+  PrepareBenchmark() : Benchmark("Prepare") {}
+
+  void run() override {
+    const auto cacheFile =
+        File::getSpecialLocation(File::tempDirectory)
+            .getChildFile("BlackBirdBenchmarks")
+            .getChildFile("LookupTables.cache");
+
+    std::unique_ptr<SynthFixture> fixture;
+
+    auto prepare = [&] { fixture->prepare(); };
+
+    auto makeFixture = [&] {
+      // Destroyed first, so that no other instance holds the tables.
+      fixture = nullptr;
+      fixture = std::make_unique<SynthFixture>();
+      fixture->getSynth().setLookupTablesCacheFile(cacheFile);
+    };
+
+    report("Cold, tables built", measure(10, prepare, [&] {
+             makeFixture();
+             cacheFile.deleteFile();
+           }));
+
+    // Written by the last cold prepare, and flushed when its tables were
+    // released.
+    fixture = nullptr;
+
+    report("Warm, tables memory-mapped", measure(10, prepare, makeFixture));
+
+    SynthFixture otherInstance;
+    otherInstance.getSynth().setLookupTablesCacheFile(cacheFile);
+    otherInstance.prepare();
+
+    report("Shared with another instance", measure(10, prepare, makeFixture));
+
+    fixture = nullptr;
+    cacheFile.deleteFile();
+  }
+};
+
+static PrepareBenchmark prepareBenchmark;
+
+/**
+ * Compares the lookup tables of several instances, before and after they
+ * were shared: every instance building its own bank, like the synth did
+ * before the registry, with every instance acquiring the bank from the
+ * registry. Reports the time it takes to get the tables of all instances,
+ * and the memory they take, without the static sine table.
+ *
+ * No cache file is used, so the shared bank is built by the first instance.
+ * The time it takes to prepare as many synths is reported for comparison.
+ */
+class InstancesBenchmark : public Benchmark {
+public:
+  InstancesBenchmark() : Benchmark("Instances") {}
+
+  using Bank = LookupTablesBank<float>;
+  using Registry = LookupTablesRegistry<float>;
+
+  static constexpr auto sampleRate = 48000.0;
+
+  void run() override {
+    SharedResourcePointer<Registry> registry;
+
+    for (auto numberOfInstances : {1, 4, 16}) {
+      const auto label = String(numberOfInstances) + " instance(s), ";
+
+      std::vector<std::shared_ptr<const Bank>> banks;
+      std::vector<std::unique_ptr<SynthFixture>> fixtures;
+
+      auto buildOwnBanks = [&] {
+        for (auto i = 0; i < numberOfInstances; i++) {
+          auto bank = std::make_shared<Bank>();
+          bank->initialize(sampleRate);
+          banks.push_back(std::move(bank));
+        }
+      };
+
+      auto acquireSharedBanks = [&] {
+        for (auto i = 0; i < numberOfInstances; i++)
+          banks.push_back(registry->acquire(sampleRate));
+      };
+
+      auto prepareSynths = [&] {
+        for (auto i = 0; i < numberOfInstances; i++) {
+          fixtures.push_back(std::make_unique<SynthFixture>());
+          fixtures.back()->prepare();
+        }
+      };
+
+      auto release = [&] {
+        const std::weak_ptr<const Bank> sharedBank =
+            registry->acquire(sampleRate);
+
+        banks.clear();
+        fixtures.clear();
+
+        // The registry's builder holds a bank for a moment after handing it
+        // over, and the next instances would attach to it instead.
+        for (auto i = 0; i < 1000 && !sharedBank.expired(); i++)
+          Thread::sleep(1);
+      };
+
+      report(label + "own tables", measure(3, buildOwnBanks, release));
+      report(label + "own tables, memory", megabytes(banks), "MB");
+
+      report(label + "shared tables", measure(3, acquireSharedBanks, release));
+      report(label + "shared tables, memory", megabytes(banks), "MB");
+
+      report(label + "synths prepared", measure(3, prepareSynths, release));
+      release();
+    }
+  }
+
+private:
+  /** The memory of the distinct banks' tables. */
+  static double
+  megabytes(const std::vector<std::shared_ptr<const Bank>> &banks) {
+    std::set<const Bank *> distinctBanks;
+    auto bytes = 0.0;
+
+    for (auto &bank : banks)
+      if (distinctBanks.insert(bank.get()).second)
+        bytes += (double)Bank::numberOfTableSamples(bank->numberOfChannels()) *
+                 sizeof(float);
+
+    return bytes / (1024 * 1024);
+  }
+};
+
+static InstancesBenchmark instancesBenchmark;
@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    ReverbBenchmarks.cpp
+    Created: 20 Oct 2026 10:41:25am
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+#include "FdnReverb.h"
+
+/**
+ * Compares `FdnReverb` with the `dsp::Reverb` it replaced: the time they take
+ * per stereo sample, and the decay time and echo density of their impulse
+ * responses, with the default parameters.
+ *
+ * Echo density is the fraction of a 20 ms window's samples that are further
+ * from zero than the window's standard deviation, relative to that of
+ * Gaussian noise, so 1 sounds like a dense tail.
+ */
+class ReverbBenchmark : public Benchmark {
+public:
+  ReverbBenchmark() : Benchmark("Reverb") {}
+
+  static constexpr auto sampleRate = 48000.0;
+  static constexpr auto blockSize = 512;
+
+  void run() override {
+    ScopedNoDenormals noDenormals;
+
+    measureReverb<FdnReverb>("FDN reverb");
+    measureReverb<dsp::Reverb>("dsp::Reverb");
+  }
+
+private:
+  template <typename ReverbType> static void measureReverb(const String &name) {
+    const dsp::ProcessSpec spec{sampleRate, (uint32)blockSize, 2};
+
+    AudioBuffer<float> noise(2, blockSize);
+    AudioBuffer<float> buffer(2, blockSize);
+    Random random(1);
+
+    for (auto channel = 0; channel < 2; channel++)
+      for (auto i = 0; i < blockSize; i++)
+        noise.setSample(channel, i, 0.2f * random.nextFloat() - 0.1f);
+
+    ReverbType reverb;
+    reverb.prepare(spec);
+
+    // The tail builds up for a few seconds before it's measured.
+    for (auto i = 0; i < 500; i++)
+      process(reverb, buffer, noise);
+
+    report(name + ", stereo", measure(2000, [&] {
+             process(reverb, buffer, noise);
+             keep(buffer.getSample(0, blockSize - 1));
+           }),
+           blockSize);
+
+    Reverb::Parameters wetOnly;
+    wetOnly.dryLevel = 0;
+
+    ReverbType impulseReverb;
+    impulseReverb.prepare(spec);
+    impulseReverb.setParameters(wetOnly);
+
+    const auto response = impulseResponse(impulseReverb, 3 * (int)sampleRate);
+
+    report(name + ", T60", decayTime(response), "s");
+
+    for (auto milliseconds : {50, 100, 200})
+      report(name + ", echo density at " + String(milliseconds) + " ms",
+             echoDensity(response, milliseconds), "");
+  }
+
+  template <typename ReverbType>
+  static void process(ReverbType &reverb, AudioBuffer<float> &buffer,
+                      const AudioBuffer<float> &input) {
+    for (auto channel = 0; channel < 2; channel++)
+      buffer.copyFrom(channel, 0, input.getReadPointer(channel), blockSize);
+
+    dsp::AudioBlock<float> block(buffer);
+    reverb.process(dsp::ProcessContextReplacing<float>(block));
+  }
+
+  /** The left channel's response to an impulse in both channels. */
+  template <typename ReverbType>
+  static std::vector<float> impulseResponse(ReverbType &reverb,
+                                            int numSamples) {
+    std::vector<float> left((size_t)numSamples), right((size_t)numSamples);
+    left[0] = right[0] = 1;
+
+    for (auto start = 0; start + blockSize <= numSamples; start += blockSize) {
+      float *channels[] = {left.data() + start, right.data() + start};
+      dsp::AudioBlock<float> block(channels, 2, (size_t)blockSize);
+      reverb.process(dsp::ProcessContextReplacing<float>(block));
+    }
+
+    return left;
+  }
+
+  /** Extrapolated from the decay between -5 and -35 dB of the energy. */
+  static double decayTime(const std::vector<float> &response) {
+    std::vector<double> remainingEnergy(response.size() + 1);
+
+    for (auto i = (int)response.size() - 1; i >= 0; i--)
+      remainingEnergy[(size_t)i] =
+          remainingEnergy[(size_t)i + 1] +
+          (double)response[(size_t)i] * response[(size_t)i];
+
+    auto start = -1;
+
+    for (size_t i = 0; i < response.size(); i++) {
+      const auto decibels =
+          10 * std::log10(remainingEnergy[i] / remainingEnergy[0]);
+
+      if (start < 0 && decibels < -5)
+        start = (int)i;
+
+      if (decibels < -35)
+        return 2 * (double)((int)i - start) / sampleRate;
+    }
+
+    return 0;
+  }
+
+  static double echoDensity(const std::vector<float> &response,
+                            int milliseconds) {
+    const auto windowSize = (int)(0.02 * sampleRate);
+    const auto start = (int)(milliseconds * 0.001 * sampleRate);
+
+    auto energy = 0.0;
+
+    for (auto i = start; i < start + windowSize; i++)
+      energy += (double)response[(size_t)i] * response[(size_t)i];
+
+    const auto deviation = std::sqrt(energy / windowSize);
+    auto outliers = 0;
+
+    for (auto i = start; i < start + windowSize; i++)
+      if (std::abs(response[(size_t)i]) > deviation)
+        outliers++;
+
+    // The fraction of Gaussian noise that is further than its deviation.
+    constexpr auto gaussianFraction = 0.3173;
+
+    return outliers / (double)windowSize / gaussianFraction;
+  }
+};
+
+static ReverbBenchmark reverbBenchmark;
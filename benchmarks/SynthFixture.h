@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    SynthFixture.h
+    Created: 19 Oct 2026 5:03:21pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Synth.h"
+
+/**
+ * A synth with the plugin's default parameters, played without a host. The
+ * parameters are plain atomics, so benchmarks can change them directly.
+ *
+ * Voices render on the audio thread only, unless a benchmark sets render
+ * threads before `prepare()`.
+ */
+class SynthFixture {
+public:
+  using Field = DSPParametersSnapshot::Field;
+
+  static constexpr auto numberOfChannels = 2;
+
+  explicit SynthFixture(int polyphony = Synth::defaultPolyphony) {
+    setParameter(Field::OscillatorWaveform, 1);
+    setParameter(Field::DetuningAmount, 0.5f);
+    setParameter(Field::OscillatorEngine, 0);
+
+    setParameter(Field::Cutoff, Synth::defaultCutoff);
+    setParameter(Field::Resonance, Synth::defaultResonance);
+    setParameter(Field::FilterDrive, 1);
+
+    setParameter(Field::Attack, Synth::defaultAttack);
+    setParameter(Field::Decay, Synth::defaultDecay);
+    setParameter(Field::Sustain, Synth::defaultSustain);
+    setParameter(Field::Release, Synth::defaultRelease);
+
+    setParameter(Field::CutoffEnvelopeAmount,
+                 Synth::defaultCutoffEnvelopeAmount);
+    setParameter(Field::ResonanceEnvelopeAmount,
+                 Synth::defaultResonanceEnvelopeAmount);
+    setParameter(Field::VelocityEnvelopeAmount,
+                 Synth::defaultVelocityEnvelopeAmount);
+
+    setParameter(Field::Reverb, Synth::defaultReverb);
+    setParameter(Field::MasterGain, Synth::defaultMasterGain);
+    setParameter(Field::StereoSpread, Synth::defaultStereoSpread);
+    setParameter(Field::Polyphony, (float)polyphony);
+  }
+
+  void setParameter(Field field, float value) {
+    values[(size_t)field].store(value);
+  }
+
+#pragma mark - Rendering
+
+  void prepare(double sampleRate = 48000, int blockSize = 512) {
+    buffer.setSize(numberOfChannels, blockSize);
+
+    synth.prepare(
+        {sampleRate, (uint32_t)blockSize, (uint32_t)numberOfChannels});
+    synth.startRenderThreads();
+  }
+
+  void render(const MidiBuffer &midi = {}) {
+    buffer.clear();
+    synth.renderNextBlock(buffer, midi, 0, buffer.getNumSamples());
+  }
+
+  /** Renders a block with a chord of held notes, see `addChord()`. */
+  void playChord(int numberOfNotes) {
+    MidiBuffer chord;
+    addChord(chord, numberOfNotes);
+    render(chord);
+  }
+
+  /**
+   * Times rendering `numberOfBlocks` blocks, each with the next of
+   * `midiBlocks`, cycling through them, or with no MIDI if there are none.
+   */
+  Benchmark::Statistics
+  measureBlocks(int numberOfBlocks,
+                const std::vector<MidiBuffer> &midiBlocks = {}) {
+    if (midiBlocks.empty())
+      return Benchmark::measure(numberOfBlocks, [this] { render(); });
+
+    auto block = midiBlocks.begin();
+
+    return Benchmark::measure(numberOfBlocks, [&] {
+      render(*block);
+
+      if (++block == midiBlocks.end())
+        block = midiBlocks.begin();
+    });
+  }
+
+  /**
+   * Prepares the synth with the default block size, plays a chord of
+   * `numberOfNotes` and times `numberOfBlocks` blocks of it held.
+   */
+  Benchmark::Statistics measureHeldChord(int numberOfNotes,
+                                         int numberOfBlocks) {
+    prepare();
+    playChord(numberOfNotes);
+
+    return measureBlocks(numberOfBlocks);
+  }
+
+  int getBlockSize() const { return buffer.getNumSamples(); }
+
+  /** The output of the last rendered block. */
+  const AudioBuffer<float> &getBuffer() const { return buffer; }
+
+  Synth &getSynth() { return synth; }
+
+#pragma mark - MIDI
+
+  /**
+   * Adds note-ons of `numberOfNotes` different notes, a fifth apart and
+   * folded into eight octaves.
+   */
+  static void addChord(MidiBuffer &midi, int numberOfNotes,
+                       int samplePosition = 0, int midiChannel = 1) {
+    for (auto i = 0; i < numberOfNotes; i++)
+      midi.addEvent(
+          MidiMessage::noteOn(midiChannel, 24 + 7 * i % 96, (uint8)100),
+          samplePosition);
+  }
+
+private:
+  std::array<std::atomic<float>, DSPParametersSnapshot::NumberOfFields>
+      values{};
+  DSPParameters parameters{values.data()};
+  Synth synth{parameters};
+
+  AudioBuffer<float> buffer;
+};
@@ -0,0 +1,158 @@
+/*
+  ==============================================================================
+
+    VoiceBenchmarks.cpp
+    Created: 19 Oct 2026 7:35:02pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "SynthFixture.h"
+
+/**
+ * Measures the throughput of rendering held notes with different numbers of
+ * voices, on the audio thread only.
+ */
+class VoiceRenderingBenchmark : public Benchmark {
+public:
+  VoiceRenderingBenchmark() : Benchmark("Voice Rendering") {}
+
+  void run() override {
+    for (auto numberOfVoices : {5, 16, 32, 64}) {
+      SynthFixture fixture(numberOfVoices);
+
+      report(String(numberOfVoices) + " voices",
+             fixture.measureHeldChord(numberOfVoices, 500),
+             (double)fixture.getBlockSize() * numberOfVoices, "voice sample");
+    }
+  }
+};
+
+static VoiceRenderingBenchmark voiceRenderingBenchmark;
+
+/**
+ * Measures the blocks of an instance that plays nothing: one that has never
+ * played, and one whose notes have been released and have faded out. Five
+ * held voices are measured for comparison.
+ */
+class IdleInstanceBenchmark : public Benchmark {
+public:
+  IdleInstanceBenchmark() : Benchmark("Idle Instance") {}
+
+  void run() override {
+    SynthFixture fixture;
+    fixture.prepare();
+
+    report("Never played", fixture.measureBlocks(2000));
+
+    fixture.playChord(Synth::defaultPolyphony);
+
+    report("5 voices held", fixture.measureBlocks(500));
+
+    MidiBuffer noteOffs;
+    noteOffs.addEvent(MidiMessage::allNotesOff(1), 0);
+    fixture.render(noteOffs);
+
+    // Long enough for the release and the voices' tails to fade out.
+    for (auto i = 0; i < 1000; i++)
+      fixture.render();
+
+    report("Notes released and faded", fixture.measureBlocks(2000));
+  }
+};
+
+static IdleInstanceBenchmark idleInstanceBenchmark;
+
+/**
+ * Compares rendering voices on the audio thread alone with rendering them on
+ * the render threads, from a few voices to the maximum polyphony, to find
+ * the voice count where the threads start paying off. The threads render
+ * every voice count here, whatever the synth's threshold.
+ *
+ * Also checks that the threads' output is bit-identical to the audio
+ * thread's, for a chord held and released over many blocks.
+ */
+class RenderThreadsBenchmark : public Benchmark {
+public:
+  RenderThreadsBenchmark() : Benchmark("Render Threads") {}
+
+  void run() override {
+    // At least one thread, so the threaded path is checked on any machine.
+    const auto numberOfThreads = jlimit(1, 7, SystemStats::getNumCpus() - 1);
+
+    std::cout << "  " << numberOfThreads << " render thread(s), "
+              << SystemStats::getNumCpus() << " core(s)" << std::endl;
+
+    for (auto numberOfVoices : {4, 8, 16, 32, 64}) {
+      for (auto threads : {0, numberOfThreads}) {
+        SynthFixture fixture(numberOfVoices);
+        fixture.getSynth().setNumberOfRenderThreads(threads);
+        fixture.getSynth().setMultithreadingThreshold(1);
+
+        const auto label = String(numberOfVoices) + " voices, " +
+                           (threads == 0 ? "audio thread"
+                                         : String(threads) + " thread(s)");
+
+        report(label, fixture.measureHeldChord(numberOfVoices, 500),
+               (double)fixture.getBlockSize() * numberOfVoices,
+               "voice sample");
+      }
+    }
+
+    report("Differing from audio thread",
+           (double)countDifferingSamples(numberOfThreads), "samples");
+  }
+
+private:
+  static constexpr auto numberOfComparedVoices = 32;
+  static constexpr auto numberOfComparedBlocks = 400;
+
+  /**
+   * Renders the same notes on the audio thread alone and on the threads, and
+   * counts the output samples that differ.
+   */
+  static int countDifferingSamples(int numberOfThreads) {
+    SynthFixture serial(numberOfComparedVoices);
+    SynthFixture threaded(numberOfComparedVoices);
+
+    threaded.getSynth().setNumberOfRenderThreads(numberOfThreads);
+    threaded.getSynth().setMultithreadingThreshold(1);
+
+    serial.prepare();
+    threaded.prepare();
+
+    MidiBuffer chord;
+    SynthFixture::addChord(chord, numberOfComparedVoices);
+
+    MidiBuffer noteOffs;
+    noteOffs.addEvent(MidiMessage::allNotesOff(1), 100);
+
+    auto differingSamples = 0;
+
+    for (auto block = 0; block < numberOfComparedBlocks; block++) {
+      // The chord is held, released halfway through, and fades out.
+      const auto &midi = block == 0 ? chord
+                         : block == numberOfComparedBlocks / 2 ? noteOffs
+                                                               : MidiBuffer();
+
+      serial.render(midi);
+      threaded.render(midi);
+
+      const auto &serialOutput = serial.getBuffer();
+      const auto &threadedOutput = threaded.getBuffer();
+
+      for (auto channel = 0; channel < serialOutput.getNumChannels();
+           channel++)
+        for (auto i = 0; i < serialOutput.getNumSamples(); i++)
+          if (serialOutput.getSample(channel, i) !=
+              threadedOutput.getSample(channel, i))
+            differingSamples++;
+    }
+
+    return differingSamples;
+  }
+};
+
+static RenderThreadsBenchmark renderThreadsBenchmark;
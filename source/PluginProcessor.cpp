@@ -24,21 +24,37 @@ BlackBirdAudioProcessor::BlackBirdAudioProcessor()
       )
 #endif
 {
+  _synth.setLookupTablesCacheFile(
+      getUserDataDirectory().getChildFile("LookupTables.cache"));
+
+  startTimer(releaseIntervalMilliseconds);
 }
 
-BlackBirdAudioProcessor::~BlackBirdAudioProcessor() {}
+BlackBirdAudioProcessor::~BlackBirdAudioProcessor() { stopTimer(); }
+
+void BlackBirdAudioProcessor::timerCallback() {
+  _synth.releaseReplacedObjects();
+}
 
 #pragma mark - Lifecycle
 
 void BlackBirdAudioProcessor::prepareToPlay(double sampleRate,
                                             int samplesPerBlock) {
+  // Offline renders must never hear the fallback waveforms
+  _synth.setBuildsLookupTablesAsynchronously(!isNonRealtime());
+
   _synth.prepare({sampleRate, (uint32_t)samplesPerBlock,
                   (uint32_t)getTotalNumOutputChannels()});
+  _synth.startRenderThreads();
+
+  isPrepared = true;
 }
 
 void BlackBirdAudioProcessor::releaseResources() {
-  // When playback stops, you can use this as an opportunity to free up any
-  // spare memory, etc.
+  // Idle workers would keep their real-time threads while nothing plays.
+  _synth.stopRenderThreads();
+
+  isPrepared = false;
 }
 
 #pragma mark - Capatibilites
@@ -166,18 +182,52 @@ void BlackBirdAudioProcessor::getStateInformation(MemoryBlock &destData) {
   copyXmlToBinary(*xml, destData);
 }
 
+void BlackBirdAudioProcessor::getPresetInformation(MemoryBlock &destData) {
+  auto state = valueTreeState.copyState();
+  removeSessionSettings(state);
+
+  std::unique_ptr<XmlElement> xml(state.createXml());
+  copyXmlToBinary(*xml, destData);
+}
+
 void BlackBirdAudioProcessor::setStateInformation(const void *data,
                                                   int sizeInBytes) {
   std::unique_ptr<XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
 
-  if (xmlState != nullptr)
-    if (xmlState->hasTagName(valueTreeState.state.getType()))
-      valueTreeState.replaceState(ValueTree::fromXml(*xmlState));
+  if (xmlState == nullptr ||
+      !xmlState->hasTagName(valueTreeState.state.getType()))
+    return;
+
+  auto state = ValueTree::fromXml(*xmlState);
+
+  // Older states kept the channel presets among the plugin's properties.
+  auto channelPresets = state.getOrCreateChildWithName(channelPresetsType,
+                                                       nullptr);
+
+  for (auto midiChannel = 1; midiChannel <= Synth::numberOfMidiChannels;
+       midiChannel++) {
+    const auto propertyName = channelPresetPropertyName(midiChannel);
+
+    if (state.hasProperty(propertyName)) {
+      channelPresets.setProperty(propertyName, state[propertyName], nullptr);
+      state.removeProperty(propertyName, nullptr);
+    }
+  }
+
+  loadState(state);
+}
+
+void BlackBirdAudioProcessor::loadState(const ValueTree &newState) {
+  valueTreeState.replaceState(newState);
+
+  updateUserWavetable();
+  updateChannelPresets();
+  updateRenderThreads();
 }
 
 #pragma mark - Handling Presets
 
-File BlackBirdAudioProcessor::getPresetsDirectory() {
+File BlackBirdAudioProcessor::getUserDataDirectory() {
   auto userDataFolder =
       File::getSpecialLocation(
           File::SpecialLocationType::commonApplicationDataDirectory)
@@ -187,14 +237,16 @@ File BlackBirdAudioProcessor::getPresetsDirectory() {
     userDataFolder.createDirectory();
   }
 
-  auto presetsFolder = userDataFolder.getChildFile("Presets");
+  return userDataFolder;
+}
+
+File BlackBirdAudioProcessor::getPresetsDirectory() {
+  auto presetsFolder = getUserDataDirectory().getChildFile("Presets");
 
   if (!presetsFolder.exists()) {
     presetsFolder.createDirectory();
   }
 
-  std::cout << "Presets directory: " << presetsFolder.getFullPathName() << "\n";
-
   return presetsFolder;
 }
 
@@ -211,18 +263,202 @@ StringArray BlackBirdAudioProcessor::getPresetsNames() {
 }
 
 void BlackBirdAudioProcessor::loadPreset(const String &presetName) {
-  auto presetPath =
-      getPresetsDirectory().getChildFile(presetName + ".blackBird");
-  auto presetFile = File(presetPath);
-  MemoryBlock data;
+  auto presetState = readPresetState(presetName);
 
-  if (presetFile.loadFileAsData(data)) {
-    setStateInformation(data.getData(), (int)data.getSize());
-  } else {
+  if (!presetState.isValid()) {
     AlertWindow::showMessageBoxAsync(
         AlertWindow::WarningIcon, TRANS("Error whilst loading"),
         TRANS("Couldn't read from the specified file!"));
-  };
+    return;
+  }
+
+  // The session's settings are never changed by a preset.
+  removeSessionSettings(presetState);
+
+  for (auto *type : {channelPresetsType, settingsType})
+    presetState.appendChild(
+        valueTreeState.state.getOrCreateChildWithName(type, nullptr)
+            .createCopy(),
+        nullptr);
+
+  loadState(presetState);
+}
+
+ValueTree BlackBirdAudioProcessor::readPresetState(const String &presetName) {
+  MemoryBlock data;
+  if (!getPresetsDirectory()
+           .getChildFile(presetName + ".blackBird")
+           .loadFileAsData(data))
+    return {};
+
+  std::unique_ptr<XmlElement> xmlState(
+      getXmlFromBinary(data.getData(), (int)data.getSize()));
+
+  if (xmlState == nullptr ||
+      !xmlState->hasTagName(valueTreeState.state.getType()))
+    return {};
+
+  return ValueTree::fromXml(*xmlState);
+}
+
+#pragma mark - Multi-Timbral Mode
+
+void BlackBirdAudioProcessor::setChannelPreset(int midiChannel,
+                                               const String &presetName) {
+  jassert(midiChannel > 0 && midiChannel <= Synth::numberOfMidiChannels);
+
+  const auto propertyName = channelPresetPropertyName(midiChannel);
+  auto channelPresets =
+      valueTreeState.state.getOrCreateChildWithName(channelPresetsType,
+                                                    nullptr);
+
+  if (presetName.isEmpty())
+    channelPresets.removeProperty(propertyName, nullptr);
+  else
+    channelPresets.setProperty(propertyName, presetName, nullptr);
+
+  updateChannelPresets();
+}
+
+String BlackBirdAudioProcessor::getChannelPreset(int midiChannel) const {
+  const auto propertyName = channelPresetPropertyName(midiChannel);
+  return valueTreeState.state.getChildWithName(channelPresetsType)
+      .getProperty(propertyName)
+      .toString();
+}
+
+Identifier BlackBirdAudioProcessor::channelPresetPropertyName(int midiChannel) {
+  return "channelPreset" + String(midiChannel);
+}
+
+void BlackBirdAudioProcessor::removeSessionSettings(ValueTree &state) {
+  state.removeChild(state.getChildWithName(channelPresetsType), nullptr);
+  state.removeChild(state.getChildWithName(settingsType), nullptr);
+
+  // Presets saved by older versions kept them among the plugin's properties.
+  for (auto midiChannel = 1; midiChannel <= Synth::numberOfMidiChannels;
+       midiChannel++)
+    state.removeProperty(channelPresetPropertyName(midiChannel), nullptr);
+}
+
+void BlackBirdAudioProcessor::updateChannelPresets() {
+  for (auto midiChannel = 1; midiChannel <= Synth::numberOfMidiChannels;
+       midiChannel++) {
+    const auto presetName = getChannelPreset(midiChannel);
+
+    // A preset file is only read when the channel is given another preset.
+    if (presetName == appliedChannelPresets[(size_t)midiChannel])
+      continue;
+
+    appliedChannelPresets[(size_t)midiChannel] = presetName;
+
+    const auto presetState =
+        presetName.isEmpty() ? ValueTree() : readPresetState(presetName);
+
+    // Channels whose preset is gone follow the plugin's parameters.
+    if (!presetState.isValid()) {
+      _synth.setChannelParameters(midiChannel, nullptr);
+      continue;
+    }
+
+    // The synth keeps the patch alive through its parameters.
+    auto patch =
+        std::make_shared<const DSPParametersPatch>(presetState, valueTreeState);
+    _synth.setChannelParameters(
+        midiChannel,
+        std::shared_ptr<const DSPParameters>(patch, &patch->getParameters()));
+  }
+}
+
+#pragma mark - Rendering on Threads
+
+void BlackBirdAudioProcessor::setNumberOfRenderThreads(int numberOfThreads) {
+  valueTreeState.state.getOrCreateChildWithName(settingsType, nullptr)
+      .setProperty(renderThreadsPropertyName,
+                   jlimit(0, getMaxNumberOfRenderThreads(), numberOfThreads),
+                   nullptr);
+
+  updateRenderThreads();
+}
+
+int BlackBirdAudioProcessor::getNumberOfRenderThreads() const {
+  return valueTreeState.state.getChildWithName(settingsType)
+      .getProperty(renderThreadsPropertyName, 0);
+}
+
+int BlackBirdAudioProcessor::getMaxNumberOfRenderThreads() {
+  // One core is left to the audio thread, which renders voices too.
+  return jlimit(0, 7, SystemStats::getNumCpus() - 1);
+}
+
+void BlackBirdAudioProcessor::updateRenderThreads() {
+  const auto numberOfThreads =
+      jlimit(0, getMaxNumberOfRenderThreads(), getNumberOfRenderThreads());
+
+  if (numberOfThreads == _synth.getNumberOfRenderThreads())
+    return;
+
+  _synth.setNumberOfRenderThreads(numberOfThreads);
+
+  if (!isPrepared)
+    return;
+
+  // The threads mustn't change while a block is rendering.
+  suspendProcessing(true);
+  _synth.startRenderThreads();
+  suspendProcessing(false);
+}
+
+#pragma mark - Handling User Wavetables
+
+File BlackBirdAudioProcessor::getWavetablesDirectory() {
+  auto wavetablesFolder = getUserDataDirectory().getChildFile("Wavetables");
+
+  if (!wavetablesFolder.exists()) {
+    wavetablesFolder.createDirectory();
+  }
+
+  return wavetablesFolder;
+}
+
+bool BlackBirdAudioProcessor::importWavetable(const File &wavFile) {
+  const auto tableResolution = LookupTablesBank<float>::tableResolution;
+
+  Wavetable<float> wavetable;
+  if (!wavetable.loadFromFile(wavFile, tableResolution))
+    return false;
+
+  // Imported files are never overwritten, so the cached tables of a
+  // wavetable always match its file.
+  auto importedFile = getWavetablesDirectory().getNonexistentChildFile(
+      wavFile.getFileNameWithoutExtension(), ".wav", false);
+
+  if (!wavFile.copyFileTo(importedFile))
+    return false;
+
+  valueTreeState.state.setProperty(wavetablePropertyName,
+                                   importedFile.getFileName(), nullptr);
+  updateUserWavetable();
+
+  return true;
+}
+
+void BlackBirdAudioProcessor::clearWavetable() {
+  valueTreeState.state.removeProperty(wavetablePropertyName, nullptr);
+  updateUserWavetable();
+}
+
+void BlackBirdAudioProcessor::updateUserWavetable() {
+  auto wavetableName =
+      valueTreeState.state.getProperty(wavetablePropertyName).toString();
+
+  if (wavetableName.isEmpty()) {
+    _synth.setUserWavetable(File());
+    return;
+  }
+
+  _synth.setUserWavetable(getWavetablesDirectory().getChildFile(
+      File::createLegalFileName(wavetableName)));
 }
 
 #pragma mark - Creating Editor Instance
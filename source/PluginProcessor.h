@@ -16,7 +16,7 @@
 
 using namespace juce;
 
-class BlackBirdAudioProcessor : public AudioProcessor {
+class BlackBirdAudioProcessor : public AudioProcessor, private Timer {
 public:
 #pragma mark - Listening to Changes
 
@@ -68,12 +68,55 @@ public:
   void getStateInformation(MemoryBlock &destData) override;
   void setStateInformation(const void *data, int sizeInBytes) override;
 
+  /**
+   * The state without the settings of the session, i.e. its channel presets
+   * and render threads.
+   */
+  void getPresetInformation(MemoryBlock &destData);
+
 #pragma mark - Handling Presets
 
+  File getUserDataDirectory();
   File getPresetsDirectory();
   StringArray getPresetsNames();
   void loadPreset(const String &presetName);
 
+#pragma mark - Multi-Timbral Mode
+
+  /**
+   * Makes the MIDI channel play with the preset, instead of the plugin's
+   * parameters, in the same voice pool. An empty name makes the channel
+   * follow the plugin's parameters again. Channel presets are saved with the
+   * state, but not with presets, and loading a preset keeps them.
+   */
+  void setChannelPreset(int midiChannel, const String &presetName);
+  String getChannelPreset(int midiChannel) const;
+
+#pragma mark - Rendering on Threads
+
+  /**
+   * Sets how many worker threads render voices alongside the audio thread,
+   * or 0 to render on the audio thread only. Like the channel presets, it's
+   * saved with the state, but not with presets. Threads only help with many
+   * voices and spare cores, so there are none by default.
+   */
+  void setNumberOfRenderThreads(int numberOfThreads);
+  int getNumberOfRenderThreads() const;
+
+  /** The most worker threads that are useful on this machine. */
+  static int getMaxNumberOfRenderThreads();
+
+#pragma mark - Handling User Wavetables
+
+  File getWavetablesDirectory();
+
+  /**
+   * Copies the WAV file to the wavetables directory and makes the oscillators
+   * play it. The wavetable is saved with the state and presets.
+   */
+  bool importWavetable(const File &wavFile);
+  void clearWavetable();
+
 #pragma mark - Creating Editor Instance
 
   AudioProcessorEditor *createEditor() override;
@@ -87,9 +130,37 @@ private:
       *this, nullptr, Identifier("BlackBird"), DSPParameters::makeLayout()};
 
   DSPParameters parameters{valueTreeState};
+
   Synth _synth{parameters};
 
   int currentProgram = 0;
 
+  static constexpr auto wavetablePropertyName = "wavetable";
+
+  void updateUserWavetable();
+
+  static constexpr auto channelPresetsType = "ChannelPresets";
+  static constexpr auto settingsType = "Settings";
+  static constexpr auto renderThreadsPropertyName = "renderThreads";
+
+  /** Set by `prepareToPlay()`, and cleared by `releaseResources()`. */
+  bool isPrepared = false;
+
+  /** The presets the synth's channels were last given, by channel from 1. */
+  std::array<String, Synth::numberOfMidiChannels + 1> appliedChannelPresets;
+
+  /** How often the synth's replaced objects are freed. */
+  static constexpr auto releaseIntervalMilliseconds = 1000;
+
+  void timerCallback() override;
+
+  static Identifier channelPresetPropertyName(int midiChannel);
+  static void removeSessionSettings(ValueTree &state);
+
+  ValueTree readPresetState(const String &presetName);
+  void loadState(const ValueTree &newState);
+  void updateChannelPresets();
+  void updateRenderThreads();
+
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlackBirdAudioProcessor)
 };
@@ -41,30 +41,157 @@ inline NormalisableRange<float> makeGainRange() {
 #pragma mark - Construction
 
 DSPParameters::DSPParameters(AudioProcessorValueTreeState &valueTreeState) {
+  bind([&](DSPParametersSnapshot::Field field) {
+    return valueTreeState.getRawParameterValue(parameterID(field));
+  });
+}
+
+DSPParameters::DSPParameters(std::atomic<float> *values) {
+  bind([values](DSPParametersSnapshot::Field field) { return &values[field]; });
+}
+
+template <typename GetRawValue>
+void DSPParameters::bind(GetRawValue &&getRawValue) {
+  using Field = DSPParametersSnapshot::Field;
+
+  oscillatorWaveform = getRawValue(Field::OscillatorWaveform);
+  detuningAmount = getRawValue(Field::DetuningAmount);
+  oscillatorEngine = getRawValue(Field::OscillatorEngine);
+
+  cutoff = getRawValue(Field::Cutoff);
+  resonance = getRawValue(Field::Resonance);
+  filterDrive = getRawValue(Field::FilterDrive);
+
+  attack = getRawValue(Field::Attack);
+  decay = getRawValue(Field::Decay);
+  sustain = getRawValue(Field::Sustain);
+  release = getRawValue(Field::Release);
+
+  cutoffEnvelopeAmount = getRawValue(Field::CutoffEnvelopeAmount);
+  resonanceEnvelopeAmount = getRawValue(Field::ResonanceEnvelopeAmount);
+  velocityEnvelopeAmount = getRawValue(Field::VelocityEnvelopeAmount);
+
+  reverb = getRawValue(Field::Reverb);
+  masterGain = getRawValue(Field::MasterGain);
+  stereoSpread = getRawValue(Field::StereoSpread);
+
+  polyphony = getRawValue(Field::Polyphony);
+}
+
+const char *DSPParameters::parameterID(DSPParametersSnapshot::Field field) {
   using namespace DSPParametersConstants;
+  using Field = DSPParametersSnapshot::Field;
+
+  switch (field) {
+  case Field::OscillatorWaveform:
+    return oscillatorWaveformParameterID;
+  case Field::DetuningAmount:
+    return characterParameterID;
+  case Field::OscillatorEngine:
+    return oscillatorEngineParameterID;
+
+  case Field::Cutoff:
+    return filterCutoffParameterID;
+  case Field::Resonance:
+    return filterResonanceParameterID;
+  case Field::FilterDrive:
+    return filterDriveParameterID;
+
+  case Field::Attack:
+    return attackParameterID;
+  case Field::Decay:
+    return decayParameterID;
+  case Field::Sustain:
+    return sustainParameterID;
+  case Field::Release:
+    return releaseParameterID;
+
+  case Field::CutoffEnvelopeAmount:
+    return cutoffEnvelopeAmountParameterID;
+  case Field::ResonanceEnvelopeAmount:
+    return resonanceEnvelopeAmountParameterID;
+  case Field::VelocityEnvelopeAmount:
+    return velocityEnvelopeAmountParameterID;
+
+  case Field::Reverb:
+    return reverbParameterID;
+  case Field::MasterGain:
+    return masterGainParameterID;
+  case Field::StereoSpread:
+    return stereoSpreadParameterID;
+  case Field::Polyphony:
+    return polyphonyParameterID;
+
+  case Field::NumberOfFields:
+    break;
+  }
+
+  jassertfalse;
+  return "";
+}
 
-  oscillatorWaveform =
-      valueTreeState.getRawParameterValue(oscillatorWaveformParameterID);
-  detuningAmount = valueTreeState.getRawParameterValue(characterParameterID);
+#pragma mark - Snapshot
 
-  cutoff = valueTreeState.getRawParameterValue(filterCutoffParameterID);
-  resonance = valueTreeState.getRawParameterValue(filterResonanceParameterID);
-  filterDrive = valueTreeState.getRawParameterValue(filterDriveParameterID);
+void DSPParameters::updateSnapshot(DSPParametersSnapshot &snapshot) const {
+  using Field = DSPParametersSnapshot::Field;
 
-  attack = valueTreeState.getRawParameterValue(attackParameterID);
-  decay = valueTreeState.getRawParameterValue(decayParameterID);
-  sustain = valueTreeState.getRawParameterValue(sustainParameterID);
-  release = valueTreeState.getRawParameterValue(releaseParameterID);
+  snapshot.changedFields = 0;
 
-  cutoffEnvelopeAmount =
-      valueTreeState.getRawParameterValue(cutoffEnvelopeAmountParameterID);
-  resonanceEnvelopeAmount =
-      valueTreeState.getRawParameterValue(resonanceEnvelopeAmountParameterID);
-  velocityEnvelopeAmount =
-      valueTreeState.getRawParameterValue(velocityEnvelopeAmountParameterID);
+  auto read = [&](Field field, const std::atomic<float> *source,
+                  float &value) {
+    const auto newValue = source->load(std::memory_order_relaxed);
+    if (newValue == value)
+      return;
 
-  reverb = valueTreeState.getRawParameterValue(reverbParameterID);
-  masterGain = valueTreeState.getRawParameterValue(masterGainParameterID);
+    value = newValue;
+    snapshot.changedFields |= DSPParametersSnapshot::fieldSet(field);
+  };
+
+  read(Field::OscillatorWaveform, oscillatorWaveform,
+       snapshot.oscillatorWaveform);
+  read(Field::DetuningAmount, detuningAmount, snapshot.detuningAmount);
+  read(Field::OscillatorEngine, oscillatorEngine, snapshot.oscillatorEngine);
+
+  read(Field::Cutoff, cutoff, snapshot.cutoff);
+  read(Field::Resonance, resonance, snapshot.resonance);
+  read(Field::FilterDrive, filterDrive, snapshot.filterDrive);
+
+  read(Field::Attack, attack, snapshot.attack);
+  read(Field::Decay, decay, snapshot.decay);
+  read(Field::Sustain, sustain, snapshot.sustain);
+  read(Field::Release, release, snapshot.release);
+
+  read(Field::CutoffEnvelopeAmount, cutoffEnvelopeAmount,
+       snapshot.cutoffEnvelopeAmount);
+  read(Field::ResonanceEnvelopeAmount, resonanceEnvelopeAmount,
+       snapshot.resonanceEnvelopeAmount);
+  read(Field::VelocityEnvelopeAmount, velocityEnvelopeAmount,
+       snapshot.velocityEnvelopeAmount);
+
+  read(Field::Reverb, reverb, snapshot.reverb);
+  read(Field::MasterGain, masterGain, snapshot.masterGain);
+  read(Field::StereoSpread, stereoSpread, snapshot.stereoSpread);
+  read(Field::Polyphony, polyphony, snapshot.polyphony);
+}
+
+#pragma mark - Patches
+
+DSPParametersPatch::DSPParametersPatch(const ValueTree &state,
+                                       AudioProcessorValueTreeState &fallback)
+    : parameters(values.data()) {
+  for (auto i = 0; i < DSPParametersSnapshot::NumberOfFields; i++) {
+    const auto *parameterID =
+        DSPParameters::parameterID((DSPParametersSnapshot::Field)i);
+
+    // The state stores a PARAM child with the unnormalised value of every
+    // parameter.
+    const auto parameterState = state.getChildWithProperty("id", parameterID);
+    const auto fallbackValue =
+        fallback.getRawParameterValue(parameterID)->load();
+
+    values[(size_t)i] =
+        (float)parameterState.getProperty("value", fallbackValue);
+  }
 }
 
 #pragma mark - Layout
@@ -72,9 +199,12 @@ DSPParameters::DSPParameters(AudioProcessorValueTreeState &valueTreeState) {
 AudioProcessorValueTreeState::ParameterLayout DSPParameters::makeLayout() {
   using namespace DSPParametersConstants;
   return {
-      std::make_unique<AudioParameterInt>(oscillatorWaveformParameterID,
-                                          oscillatorWaveformParameterName, 0, 2,
-                                          0, filterCutoffParameterName),
+      // Was an AudioParameterInt over the same range, so older presets with
+      // whole waveform numbers still load.
+      std::make_unique<AudioParameterFloat>(
+          oscillatorWaveformParameterID, oscillatorWaveformParameterName,
+          NormalisableRange(0.0f, 2.0f, 0.01f), 0.0f,
+          oscillatorWaveformParameterName),
 
       std::make_unique<AudioParameterFloat>(
           characterParameterID, characterParameterName,
@@ -145,5 +275,20 @@ AudioProcessorValueTreeState::ParameterLayout DSPParameters::makeLayout() {
 
       std::make_unique<AudioParameterFloat>(
           masterGainParameterID, masterGainParameterName, makeGainRange(),
-          Synth::defaultMasterGain, masterGainParameterID)};
+          Synth::defaultMasterGain, masterGainParameterID),
+
+      std::make_unique<AudioParameterFloat>(
+          stereoSpreadParameterID, stereoSpreadParameterName,
+          NormalisableRange(0.0f, 1.0f, 0.01f), Synth::defaultStereoSpread,
+          stereoSpreadParameterName),
+
+      std::make_unique<AudioParameterInt>(
+          polyphonyParameterID, polyphonyParameterName, 1, Synth::maxPolyphony,
+          Synth::defaultPolyphony, polyphonyParameterName),
+
+      // Added last, so the parameters before it keep their host indices.
+      std::make_unique<AudioParameterChoice>(
+          oscillatorEngineParameterID, oscillatorEngineParameterName,
+          StringArray{"Wavetable", "PolyBLEP"}, 0,
+          oscillatorEngineParameterName)};
 }
\ No newline at end of file
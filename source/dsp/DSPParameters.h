@@ -7,6 +7,8 @@
 
   ==============================================================================
 */
+#include <array>
+#include <atomic>
 #include <iostream>
 #include <juce_audio_processors/juce_audio_processors.h>
 
@@ -19,6 +21,8 @@ constexpr auto oscillatorWaveformParameterID = "oscillatorWaveform";
 constexpr auto oscillatorWaveformParameterName = "Oscillator Waveform";
 constexpr auto characterParameterID = "detuning";
 constexpr auto characterParameterName = "Character";
+constexpr auto oscillatorEngineParameterID = "oscillatorEngine";
+constexpr auto oscillatorEngineParameterName = "Oscillator Engine";
 
 constexpr auto filterCutoffParameterID = "filterCutoff";
 constexpr auto filterCutoffParameterName = "Filter Cutoff";
@@ -49,11 +53,88 @@ constexpr auto reverbParameterName = "Reverb";
 
 constexpr auto masterGainParameterID = "masterGain";
 constexpr auto masterGainParameterName = "Master Gain";
+
+constexpr auto stereoSpreadParameterID = "stereoSpread";
+constexpr auto stereoSpreadParameterName = "Stereo Spread";
+
+constexpr auto polyphonyParameterID = "polyphony";
+constexpr auto polyphonyParameterName = "Polyphony";
 } // namespace DSPParametersConstants
 
+/**
+ * Values of all parameters, read from the atomics once per block, so that
+ * voices don't touch the atomics while rendering.
+ *
+ * `changedFields` has a bit set for every field that changed since the
+ * previous snapshot, so that voices only recompute what depends on them.
+ */
+struct alignas(64) DSPParametersSnapshot {
+  enum Field {
+    OscillatorWaveform,
+    DetuningAmount,
+    OscillatorEngine,
+
+    Cutoff,
+    Resonance,
+    FilterDrive,
+
+    Attack,
+    Decay,
+    Sustain,
+    Release,
+
+    CutoffEnvelopeAmount,
+    ResonanceEnvelopeAmount,
+    VelocityEnvelopeAmount,
+
+    Reverb,
+    MasterGain,
+    StereoSpread,
+    Polyphony,
+
+    NumberOfFields
+  };
+
+  /** Bitmask of fields, with a bit set for every `Field`. */
+  using FieldSet = uint32_t;
+
+  static constexpr FieldSet allFields = (1u << NumberOfFields) - 1;
+
+  static constexpr FieldSet fieldSet(Field field) { return 1u << field; }
+
+  float oscillatorWaveform = 0;
+  float detuningAmount = 0;
+  float oscillatorEngine = 0;
+
+  float cutoff = 0;
+  float resonance = 0;
+  float filterDrive = 0;
+
+  float attack = 0;
+  float decay = 0;
+  float sustain = 0;
+  float release = 0;
+
+  float cutoffEnvelopeAmount = 0;
+  float resonanceEnvelopeAmount = 0;
+  float velocityEnvelopeAmount = 0;
+
+  float reverb = 0;
+  float masterGain = 0;
+  float stereoSpread = 0;
+  float polyphony = 0;
+
+  FieldSet changedFields = allFields;
+
+  bool hasChanged(FieldSet fields) const {
+    return (changedFields & fields) != 0;
+  }
+};
+
 struct DSPParameters {
   std::atomic<float> *oscillatorWaveform = nullptr;
   std::atomic<float> *detuningAmount = nullptr;
+  std::atomic<float> *oscillatorEngine = nullptr;
 
   std::atomic<float> *cutoff = nullptr;
   std::atomic<float> *resonance = nullptr;
@@ -70,8 +151,50 @@ struct DSPParameters {
 
   std::atomic<float> *reverb = nullptr;
   std::atomic<float> *masterGain = nullptr;
+  std::atomic<float> *stereoSpread = nullptr;
+
+  std::atomic<float> *polyphony = nullptr;
 
   explicit DSPParameters(AudioProcessorValueTreeState &valueTreeState);
 
+  /** Reads the values from `values`, which has an atomic for every field. */
+  explicit DSPParameters(std::atomic<float> *values);
+
+  /** Reads all parameters into the snapshot and marks the changed ones. */
+  void updateSnapshot(DSPParametersSnapshot &snapshot) const;
+
   static AudioProcessorValueTreeState::ParameterLayout makeLayout();
+
+  /** The ID of the plugin parameter that the snapshot field is read from. */
+  static const char *parameterID(DSPParametersSnapshot::Field field);
+
+private:
+  template <typename GetRawValue> void bind(GetRawValue &&getRawValue);
+};
+
+/**
+ * Parameter values that aren't attached to the plugin's parameters, e.g. the
+ * preset of a MIDI channel in multi-timbral mode.
+ *
+ * A patch never changes after it's created, so a snapshot of it never mixes
+ * two presets. Load another patch to replace it.
+ */
+class DSPParametersPatch {
+public:
+  /**
+   * Loads the parameter values of a plugin state, e.g. a preset's. The
+   * parameters that are missing from the state take their current values in
+   * `fallback`.
+   */
+  DSPParametersPatch(const ValueTree &state,
+                     AudioProcessorValueTreeState &fallback);
+
+  const DSPParameters &getParameters() const { return parameters; }
+
+private:
+  std::array<std::atomic<float>, DSPParametersSnapshot::NumberOfFields>
+      values{};
+  DSPParameters parameters;
+
+  JUCE_DECLARE_NON_COPYABLE(DSPParametersPatch)
 };
@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    Envelope.h
+    Created: 18 Oct 2026 10:04:37pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cmath>
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+using namespace juce;
+
+/**
+ * ADSR envelope with analog-style exponential segments, rendered at audio
+ * rate.
+ *
+ * Like the capacitor of an analog envelope, every segment approaches a target
+ * that lies beyond the level it ends at, so that it ends in finite time. The
+ * segment's curve and length are computed in closed form when it starts, and
+ * `render()` then fills whole segments without per-sample branches.
+ *
+ * The durations are those of full-range segments, e.g. the decay duration is
+ * the time it takes to fall from 1 to 0.
+ */
+class Envelope {
+public:
+  struct Parameters {
+    float attack = 0.1f;
+    float decay = 0.1f;
+    float sustain = 1.0f;
+    float release = 0.1f;
+  };
+
+  enum class Stage { Idle, Attack, Decay, Sustain, Release };
+
+  /** How far beyond its end the attack aims, relative to the full range. */
+  static constexpr auto attackOvershoot = 0.3f;
+
+  /** How far beyond their ends the decay and release aim. */
+  static constexpr auto decayOvershoot = 0.0001f;
+
+#pragma mark - Setting Parameters
+
+  void setSampleRate(double newSampleRate) {
+    jassert(newSampleRate > 0);
+    sampleRate = newSampleRate;
+  }
+
+  /**
+   * A running decay bends towards the new sustain level, and a sustained
+   * envelope glides to it in the decay time, rather than jumping.
+   */
+  void setParameters(const Parameters &newParameters) {
+    parameters = newParameters;
+
+    if (stage == Stage::Decay || stage == Stage::Sustain)
+      startDecay();
+  }
+
+#pragma mark - Note Lifecycle
+
+  void noteOn() noexcept {
+    startSegment(Stage::Attack, 1.0f, attackOvershoot, parameters.attack);
+  }
+
+  void noteOff() noexcept {
+    if (stage != Stage::Idle)
+      startSegment(Stage::Release, 0.0f, decayOvershoot, parameters.release);
+  }
+
+  void reset() noexcept {
+    stage = Stage::Idle;
+    level = 0;
+  }
+
+#pragma mark - Getting State
+
+  bool isActive() const noexcept { return stage != Stage::Idle; }
+
+  Stage getStage() const noexcept { return stage; }
+
+  /** The level of the last rendered sample. */
+  float getCurrentLevel() const noexcept { return level; }
+
+#pragma mark - Rendering
+
+  /** Renders the next samples of the envelope into `output`. */
+  void render(float *output, size_t numSamples) noexcept {
+    while (numSamples > 0) {
+      if (stage == Stage::Idle || stage == Stage::Sustain) {
+        FloatVectorOperations::fill(output, level, (int)numSamples);
+        return;
+      }
+
+      const auto count = jmin(numSamples, samplesRemaining);
+
+      renderSegment(output, count);
+
+      output += count;
+      numSamples -= count;
+      samplesRemaining -= count;
+
+      if (samplesRemaining == 0) {
+        // The curve crosses the end level within the last sample, so land
+        // on it exactly, e.g. the attack never exceeds 1.
+        level = endLevel;
+
+        if (count > 0)
+          output[-1] = endLevel;
+
+        startNextStage();
+      }
+    }
+  }
+
+private:
+  static constexpr size_t powersPerStep = 4;
+
+  double sampleRate = 44100;
+  Parameters parameters;
+
+  Stage stage = Stage::Idle;
+
+  float level = 0;
+  float endLevel = 0;
+  float target = 0;
+
+  /** Powers 1 to `powersPerStep` of the segment's per-sample coefficient. */
+  std::array<float, powersPerStep> coefficientPowers{};
+
+  size_t samplesRemaining = 0;
+
+#pragma mark - Segments
+
+  void startDecay() noexcept {
+    startSegment(Stage::Decay, parameters.sustain, decayOvershoot,
+                 parameters.decay);
+  }
+
+  void startNextStage() noexcept {
+    switch (stage) {
+    case Stage::Attack:
+      startDecay();
+      break;
+    case Stage::Decay:
+      stage = Stage::Sustain;
+      break;
+    case Stage::Release:
+      stage = Stage::Idle;
+      break;
+    default:
+      break;
+    }
+  }
+
+  /**
+   * Starts moving from the current level to `newEndLevel`, along a curve
+   * that aims `overshoot` beyond it and would cover the full range in
+   * `durationSeconds`.
+   */
+  void startSegment(Stage newStage, float newEndLevel, float overshoot,
+                    float durationSeconds) noexcept {
+    stage = newStage;
+    endLevel = newEndLevel;
+
+    const auto direction = endLevel >= level ? 1.0f : -1.0f;
+    target = endLevel + direction * overshoot;
+
+    const auto durationSamples =
+        jmax(1.0, (double)durationSeconds * sampleRate);
+    const auto coefficient = std::exp(
+        -std::log((1.0 + overshoot) / overshoot) / durationSamples);
+
+    auto power = 1.0;
+    for (auto &coefficientPower : coefficientPowers) {
+      power *= coefficient;
+      coefficientPower = (float)power;
+    }
+
+    // The distance to the target shrinks by the coefficient every sample,
+    // which gives the number of samples until it's within the overshoot.
+    const auto remainingRatio = (double)(endLevel - target) / (level - target);
+
+    samplesRemaining =
+        remainingRatio >= 1.0
+            ? 0
+            : (size_t)std::ceil(std::log(remainingRatio) /
+                                std::log(coefficient));
+  }
+
+  /**
+   * Fills the samples of the current segment. The distance to the target is
+   * advanced `powersPerStep` samples at a time, so the inner loop has no
+   * dependency between samples and vectorises.
+   */
+  void renderSegment(float *output, size_t numSamples) noexcept {
+    auto distance = level - target;
+    size_t i = 0;
+
+    for (; i + powersPerStep <= numSamples; i += powersPerStep) {
+      for (size_t j = 0; j < powersPerStep; j++)
+        output[i + j] = target + distance * coefficientPowers[j];
+
+      distance *= coefficientPowers.back();
+    }
+
+    for (; i < numSamples; i++) {
+      distance *= coefficientPowers.front();
+      output[i] = target + distance;
+    }
+
+    level = target + distance;
+  }
+};
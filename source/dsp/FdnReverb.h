@@ -0,0 +1,468 @@
+/*
+  ==============================================================================
+
+    FdnReverb.h
+    Created: 18 Oct 2026 11:52:16pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+
+using namespace juce;
+
+/**
+ * Feedback delay network reverb, a drop-in replacement for `dsp::Reverb`
+ * with the same parameters, decay and dry/wet mix.
+ *
+ * The mono input is diffused by a chain of allpasses, like the output of
+ * Freeverb's combs, and fed into eight delay lines. Their damped outputs are
+ * mixed by a Hadamard matrix and fed back, so the echo density keeps growing.
+ *
+ * Every delay is at least as long as the chunks the reverb processes, so a
+ * chunk's reads never depend on its own writes. Each stage then runs over a
+ * whole chunk of every line, and the matrix is applied with vector
+ * operations across the lines' chunks, instead of sample by sample.
+ *
+ * The delay lines and the scratch buffers share one aligned allocation,
+ * made in `prepare()`.
+ */
+class FdnReverb {
+public:
+  using Parameters = Reverb::Parameters;
+
+  static constexpr size_t numberOfLines = 8;
+  static constexpr size_t numberOfDiffusers = 4;
+
+  /** The longest chunk that is processed at once. */
+  static constexpr size_t maxChunkSize = 256;
+
+  FdnReverb() { setParameters(Parameters()); }
+
+#pragma mark - Preparing for Operation
+
+  void prepare(const dsp::ProcessSpec &spec) {
+    jassert(spec.numChannels == 1 || spec.numChannels == 2);
+
+    const auto scale = spec.sampleRate / tuningSampleRate;
+    const auto scaledLength = [scale](int tuning) {
+      return (size_t)jmax(1, roundToInt(tuning * scale));
+    };
+
+    size_t totalSize = 0;
+    chunkSize = maxChunkSize;
+
+    const auto addDelayLine = [&](DelayLine &line, int tuning) {
+      line.length = scaledLength(tuning);
+      chunkSize = jmin(chunkSize, line.length);
+      totalSize += paddedSize(line.length);
+    };
+
+    for (size_t i = 0; i < numberOfLines; i++)
+      addDelayLine(lines[i], lineTunings[i]);
+
+    for (size_t i = 0; i < numberOfDiffusers; i++)
+      addDelayLine(diffusers[i], diffuserTunings[i]);
+
+    totalSize += paddedSize(maxChunkSize) * numberOfScratchBuffers;
+
+    storage.allocate(totalSize + alignment / sizeof(float), true);
+
+    auto *buffer = reinterpret_cast<float *>(
+        (reinterpret_cast<uintptr_t>(storage.get()) + alignment - 1) &
+        ~(uintptr_t)(alignment - 1));
+
+    const auto take = [&buffer](size_t size) {
+      auto *region = buffer;
+      buffer += paddedSize(size);
+      return region;
+    };
+
+    for (auto &line : lines)
+      line.buffer = take(line.length);
+
+    for (auto &diffuser : diffusers)
+      diffuser.buffer = take(diffuser.length);
+
+    for (auto &lineChunk : lineChunks)
+      lineChunk = take(maxChunkSize);
+
+    inputChunk = take(maxChunkSize);
+    diffuserChunk = take(maxChunkSize);
+    wetLeftChunk = take(maxChunkSize);
+    wetRightChunk = take(maxChunkSize);
+
+    reset();
+  }
+
+  void reset() noexcept {
+    for (auto &line : lines)
+      line.clear();
+
+    for (auto &diffuser : diffusers)
+      diffuser.clear();
+
+    dampingStates.fill(0);
+
+    dryGain = dryGainTarget;
+    wetGain1 = wetGain1Target;
+    wetGain2 = wetGain2Target;
+  }
+
+#pragma mark - Setting Parameters
+
+  /** Changes of the dry and wet levels are ramped over the next block. */
+  void setParameters(const Parameters &newParameters) noexcept {
+    parameters = newParameters;
+
+    const auto isFrozen = parameters.freezeMode >= 0.5f;
+
+    updateMixGains();
+
+    inputGain = isFrozen ? 0.0f : fixedInputGain;
+    damping = isFrozen ? 0.0f : parameters.damping * dampingScaleFactor;
+
+    const auto feedback =
+        isFrozen ? 1.0f
+                 : parameters.roomSize * roomScaleFactor + roomOffset;
+
+    // Every line decays as much per second as Freeverb's combs do, and the
+    // matrix's normalisation is folded into the lines' gains.
+    for (size_t i = 0; i < numberOfLines; i++)
+      lineGains[i] =
+          hadamardScale *
+          std::pow(feedback, (float)lineTunings[i] / meanCombTuning);
+  }
+
+  const Parameters &getParameters() const noexcept { return parameters; }
+
+  /**
+   * Mixes the reverb's output with its input and scales the result, as in
+   * `input * inputGain + output * outputGain`, ramped over the next block.
+   *
+   * This folds a dry/wet crossfade and a following gain stage into the
+   * reverb's own mixing pass. The default mix is the reverb's output alone.
+   */
+  void setOutputMix(float inputGain, float outputGain) noexcept {
+    outputMixInputGain = inputGain;
+    outputMixOutputGain = outputGain;
+
+    updateMixGains();
+  }
+
+  /** Sets the output mix, and jumps to it without a ramp. */
+  void resetOutputMix(float inputGain, float outputGain) noexcept {
+    setOutputMix(inputGain, outputGain);
+
+    dryGain = dryGainTarget;
+    wetGain1 = wetGain1Target;
+    wetGain2 = wetGain2Target;
+  }
+
+#pragma mark - Processing
+
+  template <typename ProcessContext>
+  void process(const ProcessContext &context) noexcept {
+    const auto &inputBlock = context.getInputBlock();
+    auto &outputBlock = context.getOutputBlock();
+
+    jassert(inputBlock.getNumChannels() == outputBlock.getNumChannels());
+    jassert(outputBlock.getNumChannels() == 1 ||
+            outputBlock.getNumChannels() == 2);
+
+    if (context.usesSeparateInputAndOutputBlocks())
+      outputBlock.copyFrom(inputBlock);
+
+    if (context.isBypassed)
+      return;
+
+    const auto numSamples = outputBlock.getNumSamples();
+    if (numSamples == 0)
+      return;
+
+    auto *left = outputBlock.getChannelPointer(0);
+    auto *right = outputBlock.getNumChannels() > 1
+                      ? outputBlock.getChannelPointer(1)
+                      : nullptr;
+
+    const auto rampScale = 1.0f / (float)numSamples;
+    dryGainStep = (dryGainTarget - dryGain) * rampScale;
+    wetGain1Step = (wetGain1Target - wetGain1) * rampScale;
+    wetGain2Step = (wetGain2Target - wetGain2) * rampScale;
+
+    for (size_t offset = 0; offset < numSamples; offset += chunkSize) {
+      const auto count = jmin(chunkSize, numSamples - offset);
+
+      processChunk(left + offset, right != nullptr ? right + offset : nullptr,
+                   count);
+    }
+
+    dryGain = dryGainTarget;
+    wetGain1 = wetGain1Target;
+    wetGain2 = wetGain2Target;
+  }
+
+private:
+  /** The sample rate that the tunings are given in. */
+  static constexpr auto tuningSampleRate = 44100.0;
+
+  /** Mutually prime, and spread over the range of Freeverb's combs. */
+  static constexpr std::array<int, numberOfLines> lineTunings{
+      1117, 1187, 1277, 1361, 1423, 1493, 1559, 1621};
+
+  /** The mean delay of Freeverb's combs, whose decay the lines match. */
+  static constexpr auto meanCombTuning = 1378.0f;
+
+  /** Freeverb's allpasses, in the same order. */
+  static constexpr std::array<int, numberOfDiffusers> diffuserTunings{
+      556, 441, 341, 225};
+
+  static constexpr auto diffuserFeedback = 0.5f;
+
+  // The constants of `dsp::Reverb`.
+  static constexpr auto wetScaleFactor = 3.0f;
+  static constexpr auto dryScaleFactor = 2.0f;
+  static constexpr auto roomScaleFactor = 0.28f;
+  static constexpr auto roomOffset = 0.7f;
+  static constexpr auto dampingScaleFactor = 0.4f;
+  static constexpr auto fixedInputGain = 0.015f;
+
+  static constexpr auto hadamardScale = 0.35355339059f; // 1 / sqrt(8)
+
+  /** Signs that spread the input over all of the matrix's rows. */
+  static constexpr std::array<float, numberOfLines> inputTaps{
+      1, 1, 1, -1, 1, 1, -1, 1};
+
+  /**
+   * Orthogonal taps, so the outputs are decorrelated. Their gain gives the
+   * wet signal the loudness of Freeverb's.
+   */
+  static constexpr std::array<float, numberOfLines> leftTaps{
+      1, -1, 1, -1, 1, -1, 1, -1};
+  static constexpr std::array<float, numberOfLines> rightTaps{
+      1, 1, -1, -1, 1, 1, -1, -1};
+
+  static constexpr size_t alignment = 64;
+  static constexpr size_t numberOfScratchBuffers = numberOfLines + 4;
+
+  /** Keeps every region of the storage aligned. */
+  static constexpr size_t paddedSize(size_t size) {
+    constexpr auto floatsPerAlignment = alignment / sizeof(float);
+    return (size + floatsPerAlignment - 1) / floatsPerAlignment *
+           floatsPerAlignment;
+  }
+
+  /**
+   * A circular buffer whose length is its delay: the samples that are read
+   * at the current position were written one length ago, and are then
+   * overwritten.
+   */
+  struct DelayLine {
+    float *buffer = nullptr;
+    size_t length = 0;
+    size_t position = 0;
+
+    void clear() noexcept {
+      FloatVectorOperations::clear(buffer, (int)length);
+      position = 0;
+    }
+
+    void read(float *destination, size_t numSamples) const noexcept {
+      jassert(numSamples <= length);
+
+      const auto first = jmin(numSamples, length - position);
+      FloatVectorOperations::copy(destination, buffer + position, (int)first);
+      FloatVectorOperations::copy(destination + first, buffer,
+                                  (int)(numSamples - first));
+    }
+
+    void write(const float *source, size_t numSamples) noexcept {
+      jassert(numSamples <= length);
+
+      const auto first = jmin(numSamples, length - position);
+      FloatVectorOperations::copy(buffer + position, source, (int)first);
+      FloatVectorOperations::copy(buffer, source + first,
+                                  (int)(numSamples - first));
+
+      position += numSamples;
+      if (position >= length)
+        position -= length;
+    }
+  };
+
+  Parameters parameters;
+
+  HeapBlock<float> storage;
+  size_t chunkSize = maxChunkSize;
+
+  std::array<DelayLine, numberOfLines> lines;
+  std::array<DelayLine, numberOfDiffusers> diffusers;
+
+  std::array<float *, numberOfLines> lineChunks{};
+  float *inputChunk = nullptr;
+  float *diffuserChunk = nullptr;
+  float *wetLeftChunk = nullptr;
+  float *wetRightChunk = nullptr;
+
+  std::array<float, numberOfLines> lineGains{};
+  std::array<float, numberOfLines> dampingStates{};
+
+  float inputGain = fixedInputGain;
+  float damping = 0;
+
+  float outputMixInputGain = 0;
+  float outputMixOutputGain = 1;
+
+  float dryGain = 0, dryGainTarget = 0, dryGainStep = 0;
+  float wetGain1 = 0, wetGain1Target = 0, wetGain1Step = 0;
+  float wetGain2 = 0, wetGain2Target = 0, wetGain2Step = 0;
+
+  void updateMixGains() noexcept {
+    // The same scaling as `dsp::Reverb`, so the levels and decay match.
+    const auto outputGain = outputMixOutputGain;
+    const auto wet = parameters.wetLevel * wetScaleFactor * outputGain;
+
+    dryGainTarget =
+        outputMixInputGain + parameters.dryLevel * dryScaleFactor * outputGain;
+    wetGain1Target = 0.5f * wet * (1.0f + parameters.width);
+    wetGain2Target = 0.5f * wet * (1.0f - parameters.width);
+  }
+
+#pragma mark - Processing Chunks
+
+  void processChunk(float *left, float *right, size_t numSamples) noexcept {
+    const auto count = (int)numSamples;
+
+    // Like `dsp::Reverb`, the reverb is fed the sum of the channels.
+    if (right != nullptr)
+      FloatVectorOperations::add(inputChunk, left, right, count);
+    else
+      FloatVectorOperations::copy(inputChunk, left, count);
+
+    FloatVectorOperations::multiply(inputChunk, inputGain, count);
+
+    diffuse(numSamples);
+
+    for (size_t i = 0; i < numberOfLines; i++)
+      lines[i].read(lineChunks[i], numSamples);
+
+    FloatVectorOperations::clear(wetLeftChunk, count);
+    FloatVectorOperations::clear(wetRightChunk, count);
+
+    for (size_t i = 0; i < numberOfLines; i++) {
+      FloatVectorOperations::addWithMultiply(wetLeftChunk, lineChunks[i],
+                                             leftTaps[i], count);
+      FloatVectorOperations::addWithMultiply(wetRightChunk, lineChunks[i],
+                                             rightTaps[i], count);
+    }
+
+    dampLines(numSamples);
+    mixLines(numSamples);
+
+    for (size_t i = 0; i < numberOfLines; i++) {
+      FloatVectorOperations::addWithMultiply(lineChunks[i], inputChunk,
+                                             inputTaps[i], count);
+      lines[i].write(lineChunks[i], numSamples);
+    }
+
+    mixOutput(left, right, numSamples);
+  }
+
+  /** Runs the input chunk through Freeverb's allpasses, in place. */
+  void diffuse(size_t numSamples) noexcept {
+    for (auto &diffuser : diffusers) {
+      diffuser.read(diffuserChunk, numSamples);
+
+      for (size_t n = 0; n < numSamples; n++) {
+        const auto delayed = diffuserChunk[n];
+        diffuserChunk[n] = inputChunk[n] + delayed * diffuserFeedback;
+        inputChunk[n] = delayed - inputChunk[n];
+      }
+
+      diffuser.write(diffuserChunk, numSamples);
+    }
+  }
+
+  /**
+   * Applies the lines' lowpass filters and decay gains. The filters are
+   * recursive, so the lines are interleaved to keep their chains
+   * independent.
+   */
+  void dampLines(size_t numSamples) noexcept {
+    const auto inputCoefficient = 1.0f - damping;
+    auto states = dampingStates;
+
+    for (size_t n = 0; n < numSamples; n++) {
+      for (size_t i = 0; i < numberOfLines; i++) {
+        states[i] = lineChunks[i][n] * inputCoefficient + states[i] * damping;
+        lineChunks[i][n] = states[i] * lineGains[i];
+      }
+    }
+
+    dampingStates = states;
+  }
+
+  /** Applies the unnormalised Hadamard matrix across the lines' chunks. */
+  void mixLines(size_t numSamples) noexcept {
+    for (size_t half = 1; half < numberOfLines; half *= 2) {
+      for (size_t i = 0; i < numberOfLines; i += 2 * half) {
+        for (size_t j = i; j < i + half; j++) {
+          auto *a = lineChunks[j];
+          auto *b = lineChunks[j + half];
+
+          for (size_t n = 0; n < numSamples; n++) {
+            const auto sum = a[n] + b[n];
+            b[n] = a[n] - b[n];
+            a[n] = sum;
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Mixes the wet chunks into the dry signal in place, like `dsp::Reverb`,
+   * in a single pass. The ramped gains are computed from the sample's index
+   * rather than accumulated, so the loop has no dependency between samples
+   * and vectorises.
+   */
+  void mixOutput(float *left, float *right, size_t numSamples) noexcept {
+    const auto dryStart = dryGain, wet1Start = wetGain1, wet2Start = wetGain2;
+
+    if (right == nullptr) {
+      for (size_t n = 0; n < numSamples; n++) {
+        const auto steps = (float)(n + 1);
+
+        left[n] = wetLeftChunk[n] * (wet1Start + wetGain1Step * steps) +
+                  left[n] * (dryStart + dryGainStep * steps);
+      }
+    } else {
+      for (size_t n = 0; n < numSamples; n++) {
+        const auto steps = (float)(n + 1);
+        const auto dry = dryStart + dryGainStep * steps;
+        const auto wet1 = wet1Start + wetGain1Step * steps;
+        const auto wet2 = wet2Start + wetGain2Step * steps;
+
+        const auto wetLeft = wetLeftChunk[n];
+        const auto wetRight = wetRightChunk[n];
+
+        left[n] = wetLeft * wet1 + wetRight * wet2 + left[n] * dry;
+        right[n] = wetRight * wet1 + wetLeft * wet2 + right[n] * dry;
+      }
+    }
+
+    const auto steps = (float)numSamples;
+
+    dryGain += dryGainStep * steps;
+    wetGain1 += wetGain1Step * steps;
+    wetGain2 += wetGain2Step * steps;
+  }
+};
@@ -0,0 +1,227 @@
+/*
+  ==============================================================================
+
+    LadderFilter.h
+    Created: 18 Oct 2026 9:12:05pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+
+#include <juce_dsp/juce_dsp.h>
+
+using namespace juce;
+
+/**
+ * The math of the voices' ladder filter, modelled on `dsp::LadderFilter` in
+ * its `LPF12` mode, with the same drive and tanh saturation.
+ */
+struct LadderFilterKernel {
+  static constexpr auto numberOfStages = 5;
+
+  /** The output coefficient of `dsp::LadderFilter`'s LPF12 mode. */
+  static constexpr auto outputStageGain = 1.2f;
+  static constexpr auto resonanceCompensation = 0.5f;
+
+  struct Drive {
+    float drive{}, gain{}, drive2{}, gain2{};
+  };
+
+#pragma mark - Coefficients
+
+  static float cutoffFrequencyScaler(double sampleRate) {
+    return -2 * MathConstants<float>::pi / (float)sampleRate;
+  }
+
+  static float cutoffTransform(float cutoffFrequencyHz, float scaler) {
+    return std::exp(cutoffFrequencyHz * scaler);
+  }
+
+  static float scaledResonance(float resonance) {
+    return jmap(resonance, 0.1f, 1.0f);
+  }
+
+  static Drive drive(float drive) {
+    const auto drive2 = drive * 0.04f + 0.96f;
+
+    return {drive, std::pow(drive, -2.642f) * 0.6103f + 0.3903f, drive2,
+            std::pow(drive2, -2.642f) * 0.6103f + 0.3903f};
+  }
+
+#pragma mark - Processing
+
+  /**
+   * Built when the plugin is loaded, rather than on the audio thread at the
+   * first saturated sample.
+   */
+  inline static const dsp::LookupTableTransform<float> saturationTable{
+      [](float x) { return std::tanh(x); }, -5.0f, 5.0f, 128};
+
+  static float saturate(float input) noexcept {
+    return saturationTable(input);
+  }
+
+  /** Returns the next output sample and advances the stages. */
+  static float processSample(float input, float (&stages)[numberOfStages],
+                             float a1, float resonance,
+                             const Drive &drive) noexcept {
+    const auto g = a1 * -1.0f + 1.0f;
+    const auto b0 = g * 0.76923076923f;
+    const auto b1 = g * 0.23076923076f;
+
+    auto &s = stages;
+
+    const auto dx = drive.gain * saturate(drive.drive * input);
+    const auto a = dx + resonance * -4.0f *
+                            (drive.gain2 * saturate(drive.drive2 * s[4]) -
+                             dx * resonanceCompensation);
+
+    const auto b = b1 * s[0] + a1 * s[1] + b0 * a;
+    const auto c = b1 * s[1] + a1 * s[2] + b0 * b;
+    const auto d = b1 * s[2] + a1 * s[3] + b0 * c;
+    const auto e = b1 * s[3] + a1 * s[4] + b0 * d;
+
+    s[0] = a;
+    s[1] = b;
+    s[2] = c;
+    s[3] = d;
+    s[4] = e;
+
+    return c * outputStageGain;
+  }
+};
+
+/**
+ * Maps cutoff frequencies to the ladder filter's `a1` coefficient with a
+ * table, instead of an exponential per update. It's built for one sample
+ * rate and shared by all the voices' filters.
+ *
+ * Cutoffs outside the table's range are clamped to it.
+ */
+class LadderFilterCutoffTable {
+public:
+  /** Spaced by about 21 Hz over the voices' cutoff range. */
+  static constexpr size_t numberOfPoints = 1024;
+
+  void prepare(double sampleRate, float minCutoff, float maxCutoff) {
+    const auto scaler = LadderFilterKernel::cutoffFrequencyScaler(sampleRate);
+
+    table.initialise(
+        [scaler](float cutoffFrequencyHz) {
+          return LadderFilterKernel::cutoffTransform(cutoffFrequencyHz, scaler);
+        },
+        minCutoff, maxCutoff, numberOfPoints);
+  }
+
+  float operator()(float cutoffFrequencyHz) const noexcept {
+    return table.processSample(cutoffFrequencyHz);
+  }
+
+private:
+  dsp::LookupTableTransform<float> table;
+};
+
+/**
+ * Mono ladder filter of a single voice.
+ *
+ * Instead of smoothing parameter changes over a fixed time, the cutoff and
+ * resonance set at a control update are reached linearly over the next
+ * processed block, so a control-rate envelope is interpolated per sample.
+ */
+class LadderFilter {
+public:
+  using Kernel = LadderFilterKernel;
+
+#pragma mark - Preparing for Operation
+
+  /** The table must be prepared for the same sample rate as the filter. */
+  void setCutoffTable(const LadderFilterCutoffTable *table) {
+    cutoffTable = table;
+  }
+
+  void prepare(const dsp::ProcessSpec &spec) {
+    jassert(spec.numChannels == 1);
+
+    cutoffFrequencyScaler = Kernel::cutoffFrequencyScaler(spec.sampleRate);
+    setCutoffFrequencyHz(cutoffFrequencyHz);
+
+    reset();
+  }
+
+  /** Clears the stages and jumps to the target parameters. */
+  void reset() noexcept {
+    for (auto &stage : stages)
+      stage = 0;
+
+    a1 = a1Target;
+    resonance = resonanceTarget;
+  }
+
+#pragma mark - Setting Parameters
+
+  /** Sets the cutoff to reach by the end of the next processed block. */
+  void setCutoffFrequencyHz(float newCutoffFrequencyHz) {
+    cutoffFrequencyHz = newCutoffFrequencyHz;
+    a1Target =
+        cutoffTable != nullptr
+            ? (*cutoffTable)(cutoffFrequencyHz)
+            : Kernel::cutoffTransform(cutoffFrequencyHz, cutoffFrequencyScaler);
+  }
+
+  /** Sets the resonance to reach by the end of the next processed block. */
+  void setResonance(float newResonance) {
+    resonanceTarget = Kernel::scaledResonance(newResonance);
+  }
+
+  void setDrive(float newDrive) { drive = Kernel::drive(newDrive); }
+
+#pragma mark - Processing
+
+  template <typename ProcessContext>
+  void process(const ProcessContext &context) noexcept {
+    if (context.isBypassed)
+      return;
+
+    auto &&block = context.getOutputBlock();
+    jassert(block.getNumChannels() == 1);
+
+    process(block.getChannelPointer(0), block.getNumSamples());
+  }
+
+  void process(float *samples, size_t numSamples) noexcept {
+    if (numSamples == 0)
+      return;
+
+    const auto rampScale = 1.0f / (float)numSamples;
+    const auto a1Step = (a1Target - a1) * rampScale;
+    const auto resonanceStep = (resonanceTarget - resonance) * rampScale;
+
+    for (size_t i = 0; i < numSamples; i++) {
+      a1 += a1Step;
+      resonance += resonanceStep;
+
+      samples[i] =
+          Kernel::processSample(samples[i], stages, a1, resonance, drive);
+    }
+
+    a1 = a1Target;
+    resonance = resonanceTarget;
+  }
+
+private:
+  const LadderFilterCutoffTable *cutoffTable = nullptr;
+
+  float cutoffFrequencyScaler = Kernel::cutoffFrequencyScaler(44100);
+  float cutoffFrequencyHz = 200;
+
+  float a1 = 0, a1Target = 0;
+  float resonance = 0, resonanceTarget = Kernel::scaledResonance(0);
+
+  Kernel::Drive drive = Kernel::drive(1.2f);
+
+  float stages[Kernel::numberOfStages]{};
+};
@@ -13,52 +13,154 @@
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <memory>
+#include <vector>
 
 #include "MultibandLookupTable.h"
-#include "SineSeries.h"
+#include "StaticTables.h"
+#include "Wavetable.h"
 
 /**
- * This class groups several `MultibandLookupTable`s into single callable
- * entity.
+ * This class groups the `MultibandLookupTable`s of several waveforms into
+ * single callable entity.
+ *
+ * The waveforms are stored as interleaved channels of one table, in the order
+ * of `Waveform`, so that adjacent waveforms can be morphed in one lookup.
+ *
+ * Sine has the same single partial in every octave, so it isn't stored in the
+ * bank at all: it's read from the compile-time `sineTable`, whatever the
+ * octave.
+ *
+ * A bank can alternatively hold the frames of a user `Wavetable`, one frame
+ * per channel, in which case it contains none of the built-in waveforms.
  */
 template <typename FloatType> class LookupTablesBank {
 public:
-  static constexpr auto tableResolution = 1024;
+  static constexpr auto tableResolutionOrder = 11;
+  static constexpr auto tableResolution = 1 << tableResolutionOrder;
 
   using LookupTable = MultibandLookupTable<FloatType>;
+  using Wavetable = ::Wavetable<FloatType>;
 
 #pragma mark - Waveforms
 
   enum Waveform { Sine, Saw, Square, NumberOfWaveForms };
 
+  /** Bitmask of waveforms, with a bit set for every `Waveform`. */
+  using WaveformSet = uint32_t;
+
+  static constexpr WaveformSet allWaveforms = (1 << NumberOfWaveForms) - 1;
+
+  /** Waveforms that are read from static tables instead of the bank's. */
+  static constexpr WaveformSet staticWaveforms = 1 << Sine;
+
 #pragma mark - Construction
 
-  void initialize(double sampleRate) {
+  void initialize(double sampleRate, WaveformSet waveforms = allWaveforms) {
+    _sampleRate = sampleRate;
+    _waveforms = waveforms;
+
+    std::vector<typename LookupTable::HarmonicsGenerator> generators;
+
+    forEachWaveform([&](Waveform waveform) {
+      if (!isStatic(waveform))
+        generators.push_back(harmonicsGenerator(waveform));
+    });
+
+    table.setTable(generators, tableResolutionOrder, sampleRate);
+  }
+
+  /** Builds the tables of a user wavetable, with a channel for every frame. */
+  void initialize(double sampleRate, const Wavetable &wavetable) {
     _sampleRate = sampleRate;
+    _waveforms = 0;
+
+    table.setTable(wavetable.getSpectra(), tableResolutionOrder, sampleRate);
+  }
+
+  /**
+   * Sets up the bank from tables that were generated before, e.g. read from
+   * a cache file. `samples` are kept alive by `storage`.
+   */
+  void initialize(double sampleRate, WaveformSet waveforms,
+                  int channels, const FloatType *samples,
+                  std::shared_ptr<const void> storage) {
+    _sampleRate = sampleRate;
+    _waveforms = waveforms;
+    _storage = std::move(storage);
+
+    table.setTable(samples, channels, tableResolutionOrder);
+  }
+
+#pragma mark - Getting Properties
+
+  double sampleRate() const { return _sampleRate; }
+
+  WaveformSet waveforms() const { return _waveforms; }
+
+  bool contains(Waveform waveform) const {
+    return (_waveforms & (1 << waveform)) != 0;
+  }
+
+  static bool isStatic(Waveform waveform) {
+    return (staticWaveforms & (1 << waveform)) != 0;
+  }
+
+  /** Returns the number of the bank's table channels for the waveforms. */
+  static int numberOfTableChannels(WaveformSet waveforms) {
+    return numberOfWaveforms(waveforms & ~staticWaveforms);
+  }
 
-    tables[Sine].setTable([](FloatType /* maxFrequnecy */,
-                             FloatType value) { return std::sin(value); },
-                          tableResolution);
+  static int numberOfWaveforms(WaveformSet waveforms) {
+    auto count = 0;
+    for (; waveforms != 0; waveforms >>= 1)
+      count += waveforms & 1;
 
-    tables[Saw].setTable(
-        [this](FloatType maxFrequnecy, FloatType value) {
-          auto seriesOrder = nyquistFrequency() / maxFrequnecy;
+    return count;
+  }
+
+#pragma mark - Accessing Samples
 
-          safequardSeriesOrder(seriesOrder);
+  /** Returns the number of samples in the tables with the given channels. */
+  static size_t numberOfTableSamples(int channels) {
+    return LookupTable::numberOfSamples(tableResolutionOrder, channels);
+  }
 
-          return sawSeries<FloatType>(seriesOrder)(value);
-        },
-        tableResolution);
+  int numberOfChannels() const { return table.getNumChannels(); }
 
-    tables[Square].setTable(
-        [this](FloatType maxFrequnecy, FloatType value) {
-          auto seriesOrder = 0.5 * (nyquistFrequency() / maxFrequnecy + 1);
+  const LookupTable &getTable() const { return table; }
 
-          safequardSeriesOrder(seriesOrder);
+  const FloatType *tableSamples() const { return table.getSamples(); }
 
-          return squareSeries<FloatType>(seriesOrder)(value);
-        },
-        tableResolution);
+  /** Returns the channel of the waveform in the interleaved table. */
+  int channelForWaveform(Waveform waveform) const {
+    assert(contains(waveform) && !isStatic(waveform) &&
+           "waveform wasn't built by initialize()");
+
+    return numberOfTableChannels(_waveforms & ((1 << waveform) - 1));
+  }
+
+  /**
+   * Returns the table of the waveform that is band-limited for the given
+   * octave. Its samples are `waveformTableStride()` apart.
+   */
+  const FloatType *waveformTable(Waveform waveform, int octave) const {
+    if (isStatic(waveform))
+      return staticTable().data();
+
+    return table.octaveTable(octave) + channelForWaveform(waveform);
+  }
+
+  int waveformTableStride(Waveform waveform) const {
+    return isStatic(waveform) ? 1 : table.getNumChannels();
+  }
+
+  /** Calls `fn` for every waveform in the set, in ascending order. */
+  template <typename Function> void forEachWaveform(Function &&fn) const {
+    for (auto waveform = 0; waveform < NumberOfWaveForms; waveform++) {
+      if (contains(Waveform(waveform)))
+        fn(Waveform(waveform));
+    }
   }
 
 #pragma mark - Call Operator
@@ -67,22 +169,41 @@ public:
                        FloatType frequency) const {
     assert(_sampleRate && "intialize() must be called before operator()");
 
-    return tables[waveform](phase, frequency);
+    if (isStatic(waveform))
+      return staticTable()(phase);
+
+    return table(phase, frequency, channelForWaveform(waveform));
   }
 
 private:
 #pragma mark - Private Members
 
-  FloatType _sampleRate = 0;
+  double _sampleRate = 0;
+  WaveformSet _waveforms = 0;
 
-  std::array<LookupTable, NumberOfWaveForms> tables;
+  /** Keeps the samples alive when they aren't owned by the table. */
+  std::shared_ptr<const void> _storage;
 
-#pragma mark - Helpers
+  LookupTable table;
 
-  template <typename T> inline void safequardSeriesOrder(T &order) {
-    if (order < 1)
-      order = 1;
+#pragma mark - Static Tables
+
+  static constexpr const PeriodicTable<FloatType, tableResolutionOrder> &
+  staticTable() {
+    return sineTable<FloatType, tableResolutionOrder>;
   }
 
-  inline FloatType nyquistFrequency() { return 0.5 * _sampleRate; }
-};
\ No newline at end of file
+#pragma mark - Waveforms Spectra
+
+  static typename LookupTable::HarmonicsGenerator
+  harmonicsGenerator(Waveform waveform) {
+    switch (waveform) {
+    case Saw:
+      return [](int harmonic) { return FloatType(1) / harmonic; };
+    default:
+      return [](int harmonic) {
+        return harmonic % 2 != 0 ? FloatType(1) / harmonic : 0;
+      };
+    }
+  }
+};
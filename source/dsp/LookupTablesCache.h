@@ -0,0 +1,349 @@
+/*
+  ==============================================================================
+
+    LookupTablesCache.h
+    Created: 18 Oct 2026 12:41:05pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "LookupTablesBank.h"
+#include <juce_core/juce_core.h>
+
+using namespace juce;
+
+/**
+ * This class stores generated `LookupTablesBank`s in a binary cache file, so
+ * the tables are generated only once for every sample rate.
+ *
+ * The file holds a header, a directory of entries (one for every sample rate
+ * and waveform set), and the entries' samples, aligned to `dataAlignment`.
+ * Entries of user wavetables have an empty waveform set, and record the size,
+ * modification time and checksum of their source file, so they're never
+ * loaded after the source has changed.
+ * Banks are loaded by memory-mapping the file read-only, so the tables aren't
+ * copied. The header and the directory are validated whenever the file is
+ * read, but an entry's checksum is only verified when the entry is loaded, so
+ * loading a bank never reads the samples of the other entries.
+ */
+template <typename FloatType> class LookupTablesCache {
+public:
+  using LookupTablesBank = ::LookupTablesBank<FloatType>;
+  using WaveformSet = typename LookupTablesBank::WaveformSet;
+
+  /** Must be bumped whenever the file layout or the tables change. */
+  static constexpr uint32_t version = 5;
+
+#pragma mark - Source Files
+
+  /** Identifies the contents of the file that a bank was built from. */
+  struct Source {
+    uint64_t size = 0;
+    int64_t modificationTime = 0;
+    uint64_t checksum = 0;
+
+    /** Describes the file, or nothing if it's empty, e.g. for built-ins. */
+    static Source describe(const File &sourceFile) {
+      Source source;
+
+      if (sourceFile == File())
+        return source;
+
+      source.size = (uint64_t)sourceFile.getSize();
+      source.modificationTime =
+          sourceFile.getLastModificationTime().toMilliseconds();
+
+      MemoryMappedFile mappedFile(sourceFile, MemoryMappedFile::readOnly);
+      source.checksum =
+          LookupTablesCache::checksum(checksumSeed,
+                                      static_cast<const char *>(
+                                          mappedFile.getData()),
+                                      (uint64_t)mappedFile.getSize());
+
+      return source;
+    }
+
+    bool operator==(const Source &other) const {
+      return size == other.size &&
+             modificationTime == other.modificationTime &&
+             checksum == other.checksum;
+    }
+
+    bool operator!=(const Source &other) const { return !(*this == other); }
+  };
+
+#pragma mark - Construction
+
+  explicit LookupTablesCache(const File &file) : file(file) {}
+
+#pragma mark - Loading Banks
+
+  /**
+   * Sets up `bank` with the tables stored in the cache file. Returns false if
+   * the file is missing or stale, or doesn't contain the requested tables
+   * built from the given source.
+   */
+  bool load(LookupTablesBank &bank, double sampleRate, WaveformSet waveforms,
+            const Source &source = {}) const {
+    auto mappedFile =
+        std::make_shared<MemoryMappedFile>(file, MemoryMappedFile::readOnly);
+
+    for (auto &entry : readEntries(*mappedFile)) {
+      if (entry.header.sampleRate == sampleRate &&
+          entry.header.waveforms == waveforms &&
+          sourceOf(entry.header) == source && isIntact(entry)) {
+        bank.initialize(sampleRate, waveforms, entry.header.numberOfChannels,
+                        reinterpret_cast<const FloatType *>(entry.data),
+                        mappedFile);
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+#pragma mark - Storing Banks
+
+  /**
+   * Rewrites the cache file with all of its valid entries and the given bank,
+   * built from the given source. Entries built from another version of the
+   * source are dropped. This is slow and should be called on a background
+   * thread.
+   *
+   * The kept entries are copied with their checksums, without verifying them,
+   * so a corrupted entry is still rejected when it's loaded.
+   */
+  void store(const LookupTablesBank &bank, const Source &source = {}) const {
+    MemoryMappedFile existingFile(file, MemoryMappedFile::readOnly);
+
+    std::vector<EntryToWrite> entries;
+
+    for (auto &entry : readEntries(existingFile)) {
+      if ((entry.header.sampleRate == bank.sampleRate() &&
+           entry.header.waveforms == bank.waveforms()) ||
+          sourceOf(entry.header) != source)
+        continue;
+
+      entries.push_back({entry.header, entry.data});
+    }
+
+    entries.push_back(makeEntry(bank, source));
+
+    file.getParentDirectory().createDirectory();
+
+    // The file may still be mapped by running instances, so it's replaced
+    // rather than written in place. Where the OS doesn't allow replacing a
+    // mapped file, the cache is simply updated next time.
+    TemporaryFile temporaryFile(file);
+
+    if (writeEntries(temporaryFile.getFile(), entries))
+      temporaryFile.overwriteTargetFileWithTemporary();
+  }
+
+private:
+#pragma mark - File Layout
+
+  static constexpr char fileMagic[8] = {'B', 'B', 'T', 'A',
+                                       'B', 'L', 'E', 'S'};
+  static constexpr uint64_t dataAlignment = 64;
+  static constexpr uint64_t checksumSeed = 0xcbf29ce484222325;
+
+  struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numberOfEntries;
+  };
+
+  struct EntryHeader {
+    double sampleRate;
+    WaveformSet waveforms;
+    uint32_t numberOfChannels;
+    uint32_t tableResolution;
+    uint32_t numberOfOctaves;
+    uint32_t sampleSize;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+    uint64_t checksum;
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    uint64_t sourceChecksum;
+  };
+
+  struct Entry {
+    EntryHeader header;
+    const char *data;
+  };
+
+  /** An entry with its checksum, and without its data offset yet. */
+  struct EntryToWrite {
+    EntryHeader header;
+    const char *data;
+  };
+
+#pragma mark - Private Members
+
+  File file;
+
+#pragma mark - Reading
+
+  /**
+   * Returns the entries of the file that are compatible with this build, and
+   * lie within the file. Their samples aren't read.
+   */
+  static std::vector<Entry> readEntries(const MemoryMappedFile &mappedFile) {
+    std::vector<Entry> entries;
+
+    const auto *begin = static_cast<const char *>(mappedFile.getData());
+    const auto size = (uint64_t)mappedFile.getSize();
+
+    if (begin == nullptr || size < sizeof(FileHeader))
+      return entries;
+
+    FileHeader fileHeader;
+    std::memcpy(&fileHeader, begin, sizeof(FileHeader));
+
+    if (std::memcmp(fileHeader.magic, fileMagic, sizeof(fileMagic)) != 0 ||
+        fileHeader.version != version)
+      return entries;
+
+    const auto directorySize =
+        sizeof(FileHeader) + fileHeader.numberOfEntries * sizeof(EntryHeader);
+
+    if (size < directorySize)
+      return entries;
+
+    for (uint32_t i = 0; i < fileHeader.numberOfEntries; i++) {
+      EntryHeader header;
+      std::memcpy(&header,
+                  begin + sizeof(FileHeader) + i * sizeof(EntryHeader),
+                  sizeof(EntryHeader));
+
+      if (!isCompatible(header) || header.dataOffset % dataAlignment != 0 ||
+          header.dataOffset > size ||
+          header.dataSize > size - header.dataOffset)
+        continue;
+
+      entries.push_back({header, begin + header.dataOffset});
+    }
+
+    return entries;
+  }
+
+  static bool isIntact(const Entry &entry) {
+    return checksum(checksumSeed, entry.data, entry.header.dataSize) ==
+           entry.header.checksum;
+  }
+
+  static bool isCompatible(const EntryHeader &header) {
+    const auto channels = (int)header.numberOfChannels;
+
+    // User wavetables have no built-in waveforms, but at least one frame.
+    const auto expectedChannels =
+        header.waveforms == 0
+            ? jmax(channels, 1)
+            : LookupTablesBank::numberOfTableChannels(header.waveforms);
+
+    return header.tableResolution == LookupTablesBank::tableResolution &&
+           header.numberOfOctaves ==
+               LookupTablesBank::LookupTable::numberOfOctaves &&
+           header.sampleSize == sizeof(FloatType) &&
+           (header.waveforms & ~LookupTablesBank::allWaveforms) == 0 &&
+           channels == expectedChannels &&
+           header.dataSize == LookupTablesBank::numberOfTableSamples(channels) *
+                                  sizeof(FloatType);
+  }
+
+  static Source sourceOf(const EntryHeader &header) {
+    return {header.sourceSize, header.sourceModificationTime,
+            header.sourceChecksum};
+  }
+
+#pragma mark - Writing
+
+  static EntryToWrite makeEntry(const LookupTablesBank &bank,
+                                const Source &source) {
+    EntryToWrite entry{};
+    entry.header.sampleRate = bank.sampleRate();
+    entry.header.waveforms = bank.waveforms();
+    entry.header.numberOfChannels = (uint32_t)bank.numberOfChannels();
+    entry.header.tableResolution = LookupTablesBank::tableResolution;
+    entry.header.numberOfOctaves =
+        LookupTablesBank::LookupTable::numberOfOctaves;
+    entry.header.sampleSize = sizeof(FloatType);
+    entry.header.sourceSize = source.size;
+    entry.header.sourceModificationTime = source.modificationTime;
+    entry.header.sourceChecksum = source.checksum;
+
+    entry.header.dataSize =
+        LookupTablesBank::numberOfTableSamples(bank.numberOfChannels()) *
+        sizeof(FloatType);
+    entry.data = reinterpret_cast<const char *>(bank.tableSamples());
+    entry.header.checksum =
+        checksum(checksumSeed, entry.data, entry.header.dataSize);
+
+    return entry;
+  }
+
+  static bool writeEntries(const File &destination,
+                           std::vector<EntryToWrite> &entries) {
+    FileOutputStream stream(destination);
+
+    if (stream.failedToOpen())
+      return false;
+
+    stream.setPosition(0);
+    stream.truncate();
+
+    FileHeader fileHeader{};
+    std::memcpy(fileHeader.magic, fileMagic, sizeof(fileMagic));
+    fileHeader.version = version;
+    fileHeader.numberOfEntries = (uint32_t)entries.size();
+
+    auto dataOffset = aligned(sizeof(FileHeader) +
+                              entries.size() * sizeof(EntryHeader));
+
+    for (auto &entry : entries) {
+      entry.header.dataOffset = dataOffset;
+      dataOffset = aligned(dataOffset + entry.header.dataSize);
+    }
+
+    auto success = stream.write(&fileHeader, sizeof(FileHeader));
+
+    for (auto &entry : entries)
+      success &= stream.write(&entry.header, sizeof(EntryHeader));
+
+    for (auto &entry : entries) {
+      const auto padding =
+          entry.header.dataOffset - (uint64_t)stream.getPosition();
+      success &= stream.writeRepeatedByte(0, (size_t)padding);
+      success &= stream.write(entry.data, (size_t)entry.header.dataSize);
+    }
+
+    stream.flush();
+
+    return success && stream.getStatus().wasOk();
+  }
+
+#pragma mark - Helpers
+
+  static uint64_t aligned(uint64_t offset) {
+    return (offset + dataAlignment - 1) / dataAlignment * dataAlignment;
+  }
+
+  /** 64-bit FNV-1a hash. */
+  static uint64_t checksum(uint64_t hash, const char *data, uint64_t size) {
+    for (uint64_t i = 0; i < size; i++) {
+      hash ^= (uint8_t)data[i];
+      hash *= 0x100000001b3;
+    }
+
+    return hash;
+  }
+};
@@ -0,0 +1,339 @@
+/*
+  ==============================================================================
+
+    LookupTablesRegistry.h
+    Created: 18 Oct 2026 10:12:40am
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "LookupTablesBank.h"
+#include "LookupTablesCache.h"
+
+/**
+ * Process-wide registry of immutable `LookupTablesBank`s.
+ *
+ * All instances that run with the same sample rate, table resolution and
+ * waveform set share a single bank. The first instance builds it, the next
+ * ones attach to it, and it is freed when the last instance releases it.
+ *
+ * Banks are never modified after they are built, so they can be read from the
+ * audio threads of different instances at the same time.
+ *
+ * Banks of user wavetables are registered the same way, by their source file.
+ *
+ * When a cache file is given, banks are memory-mapped from it on the calling
+ * thread, which is cheap. Banks that aren't in the cache, or are stale there,
+ * are always built on the registry's background thread, and then written to
+ * the cache on another one. Only `acquire()` waits for such a build.
+ *
+ * Banks are built without holding the registry's lock, so a slow build never
+ * blocks instances that acquire other banks.
+ *
+ * Access it through `SharedResourcePointer<LookupTablesRegistry>`, so the
+ * registry itself lives only as long as some instance uses it.
+ */
+template <typename FloatType> class LookupTablesRegistry {
+public:
+  using LookupTablesBank = ::LookupTablesBank<FloatType>;
+  using WaveformSet = typename LookupTablesBank::WaveformSet;
+  using SharedBank = std::shared_ptr<const LookupTablesBank>;
+
+  /**
+   * Waits for the cache writes to finish, instead of letting the thread pool
+   * kill them, which would leave a temporary file behind, or dropping them,
+   * so the banks of short-lived instances, e.g. while a host scans plugins,
+   * are still cached. The builds that haven't started are dropped.
+   */
+  ~LookupTablesRegistry() {
+    builder.removeAllJobs(false, -1);
+
+    // The writer runs its jobs in order, so this one runs after the others.
+    WaitableEvent writesDidFinish;
+    cacheWriter.addJob([&writesDidFinish] { writesDidFinish.signal(); });
+    writesDidFinish.wait();
+  }
+
+#pragma mark - Acquiring Banks
+
+  /** Called with a bank once it's built. */
+  using Callback = std::function<void(SharedBank)>;
+
+  /**
+   * Returns the bank for the given sample rate, loading it from the cache, or
+   * waiting for it to be built if no other instance holds it. Meant for
+   * offline renders, which can't play without the tables. Must not be called
+   * from the audio thread.
+   */
+  SharedBank acquire(double sampleRate,
+                     WaveformSet waveforms = LookupTablesBank::allWaveforms,
+                     const File &cacheFile = File()) {
+    return acquire(makeKey(sampleRate, waveforms), cacheFile);
+  }
+
+  /**
+   * Returns the bank for the given sample rate if another instance holds it,
+   * or it's in the cache. Otherwise, returns nullptr right away, builds the
+   * bank on a background thread, and then calls `onReady` with it on that
+   * thread.
+   */
+  SharedBank acquireAsync(double sampleRate, WaveformSet waveforms,
+                          const File &cacheFile, Callback onReady) {
+    return acquireAsync(makeKey(sampleRate, waveforms), cacheFile,
+                        std::move(onReady));
+  }
+
+#pragma mark - Acquiring User Wavetables
+
+  /**
+   * Returns the bank of the wavetable imported from `wavetableFile`, or
+   * nullptr if the file can't be imported. See `acquire()`.
+   */
+  SharedBank acquireWavetable(double sampleRate, const File &wavetableFile,
+                              const File &cacheFile = File()) {
+    return acquire(makeKey(sampleRate, wavetableFile), cacheFile);
+  }
+
+  /**
+   * Returns the bank of the wavetable imported from `wavetableFile` if it's
+   * already available. See `acquireAsync()`.
+   */
+  SharedBank acquireWavetableAsync(double sampleRate,
+                                   const File &wavetableFile,
+                                   const File &cacheFile, Callback onReady) {
+    return acquireAsync(makeKey(sampleRate, wavetableFile), cacheFile,
+                        std::move(onReady));
+  }
+
+private:
+  using Cache = LookupTablesCache<FloatType>;
+
+#pragma mark - Bank Key
+
+  struct Key {
+    double sampleRate;
+    int tableResolution;
+    WaveformSet waveforms;
+
+    /** The path of the user wavetable's source file, if any. */
+    String wavetablePath;
+
+    bool operator==(const Key &other) const {
+      return sampleRate == other.sampleRate &&
+             tableResolution == other.tableResolution &&
+             waveforms == other.waveforms &&
+             wavetablePath == other.wavetablePath;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      auto hash = std::hash<double>()(key.sampleRate);
+      hash = hash * 31 + std::hash<int>()(key.tableResolution);
+      hash = hash * 31 + std::hash<WaveformSet>()(key.waveforms);
+      hash = hash * 31 + (size_t)key.wavetablePath.hash();
+
+      return hash;
+    }
+  };
+
+#pragma mark - Private Members
+
+  std::mutex mutex;
+  std::unordered_map<Key, std::weak_ptr<const LookupTablesBank>, KeyHash>
+      banks;
+  std::unordered_map<Key, std::vector<Callback>, KeyHash> pendingCallbacks;
+
+  /**
+   * Writes one cache file at a time, so updates don't race. Every write goes
+   * to a temporary file that then replaces the cache, so the cache is never
+   * left half-written.
+   */
+  ThreadPool cacheWriter{1};
+
+  /** Stopped first, since its jobs may still schedule cache writes. */
+  ThreadPool builder{1};
+
+#pragma mark - Acquiring Banks by Key
+
+  SharedBank acquire(const Key &key, const File &cacheFile) {
+    struct PendingBank {
+      WaitableEvent isReady;
+      SharedBank bank;
+    };
+
+    auto pendingBank = std::make_shared<PendingBank>();
+
+    auto onReady = [pendingBank](SharedBank bank) {
+      pendingBank->bank = std::move(bank);
+      pendingBank->isReady.signal();
+    };
+
+    if (auto bank = acquireAsync(key, cacheFile, std::move(onReady)))
+      return bank;
+
+    pendingBank->isReady.wait();
+
+    return pendingBank->bank;
+  }
+
+  SharedBank acquireAsync(const Key &key, const File &cacheFile,
+                          Callback onReady) {
+    if (auto bank = find(key))
+      return bank;
+
+    // Described before the bank is loaded or built, so a source that changes
+    // meanwhile is rebuilt next time.
+    const auto source = cacheFile != File()
+                            ? Cache::Source::describe(File(key.wavetablePath))
+                            : typename Cache::Source();
+
+    if (auto bank = registerBank(key, load(key, cacheFile, source)))
+      return bank;
+
+    const std::lock_guard<std::mutex> lock(mutex);
+
+    // Another thread may have registered the bank in the meantime.
+    if (auto bank = findLocked(key))
+      return bank;
+
+    auto &callbacks = pendingCallbacks[key];
+    callbacks.push_back(std::move(onReady));
+
+    if (callbacks.size() == 1) {
+      builder.addJob([this, key, cacheFile, source] {
+        auto bank = registerBank(key, build(key, cacheFile, source));
+
+        std::vector<Callback> callbacks;
+
+        {
+          const std::lock_guard<std::mutex> lock(mutex);
+          callbacks = std::move(pendingCallbacks[key]);
+          pendingCallbacks.erase(key);
+        }
+
+        for (auto &callback : callbacks)
+          callback(bank);
+      });
+    }
+
+    return nullptr;
+  }
+
+#pragma mark - Finding & Registering Banks
+
+  static Key makeKey(double sampleRate, WaveformSet waveforms) {
+    return {sampleRate, LookupTablesBank::tableResolution, waveforms, {}};
+  }
+
+  static Key makeKey(double sampleRate, const File &wavetableFile) {
+    return {sampleRate, LookupTablesBank::tableResolution, 0,
+            wavetableFile.getFullPathName()};
+  }
+
+  SharedBank find(const Key &key) {
+    const std::lock_guard<std::mutex> lock(mutex);
+
+    return findLocked(key);
+  }
+
+  SharedBank findLocked(const Key &key) {
+    auto it = banks.find(key);
+    if (it == banks.end())
+      return nullptr;
+
+    return it->second.lock();
+  }
+
+  /**
+   * Registers a freshly built bank and returns it, unless another thread has
+   * registered one in the meantime, in which case that one is returned.
+   */
+  SharedBank registerBank(const Key &key, SharedBank bank) {
+    const std::lock_guard<std::mutex> lock(mutex);
+
+    if (auto registeredBank = findLocked(key))
+      return registeredBank;
+
+    if (bank == nullptr)
+      return nullptr;
+
+    removeExpiredBanks();
+    banks[key] = bank;
+
+    return bank;
+  }
+
+#pragma mark - Loading & Building Banks
+
+  /** Returns nullptr if the bank isn't in the cache, or is stale there. */
+  static SharedBank load(const Key &key, const File &cacheFile,
+                         const typename Cache::Source &source) {
+    if (cacheFile == File())
+      return nullptr;
+
+    auto bank = std::make_shared<LookupTablesBank>();
+
+    if (!Cache(cacheFile).load(*bank, key.sampleRate, key.waveforms, source))
+      return nullptr;
+
+    return bank;
+  }
+
+  /**
+   * Builds a bank on the builder's thread, and schedules writing it to the
+   * cache. Returns nullptr if the user wavetable can't be imported.
+   */
+  SharedBank build(const Key &key, const File &cacheFile,
+                   const typename Cache::Source &source) {
+    auto bank = std::make_shared<LookupTablesBank>();
+
+    if (!build(*bank, key))
+      return nullptr;
+
+    if (cacheFile != File())
+      storeInBackground(bank, cacheFile, source);
+
+    return bank;
+  }
+
+  static bool build(LookupTablesBank &bank, const Key &key) {
+    if (key.wavetablePath.isEmpty()) {
+      bank.initialize(key.sampleRate, key.waveforms);
+      return true;
+    }
+
+    typename LookupTablesBank::Wavetable wavetable;
+    if (!wavetable.loadFromFile(File(key.wavetablePath),
+                                LookupTablesBank::tableResolution))
+      return false;
+
+    bank.initialize(key.sampleRate, wavetable);
+    return true;
+  }
+
+  void storeInBackground(const SharedBank &bank, const File &cacheFile,
+                         const typename Cache::Source &source) {
+    cacheWriter.addJob([bank, cacheFile, source] {
+      Cache(cacheFile).store(*bank, source);
+    });
+  }
+
+  void removeExpiredBanks() {
+    for (auto it = banks.begin(); it != banks.end();) {
+      if (it->second.expired())
+        it = banks.erase(it);
+      else
+        ++it;
+    }
+  }
+};
@@ -14,95 +14,252 @@
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <complex>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <type_traits>
 #include <juce_core/juce_core.h>
 #include <juce_dsp/juce_dsp.h>
+#include <vector>
 
 using namespace juce;
 
 /**
- * This class combines lookup tables for several frequency bands into one
- * callable entity.
+ * This class combines band-limited lookup tables for every octave of the
+ * audible range into one callable entity.
+ *
+ * Each octave's table is built by an inverse FFT of a harmonic spectrum,
+ * which is truncated so that no partial aliases into the audible range at the
+ * top of that octave. Lookups crossfade between two neighbouring octaves, so
+ * the harmonic content changes smoothly with frequency.
+ *
+ * The table holds several channels (e.g. waveforms), interleaved sample by
+ * sample, so neighbouring channels can be read and blended in one lookup.
  */
 template <typename FloatType> class MultibandLookupTable {
 public:
-  using TableGenerator =
-      std::function<FloatType(FloatType maxFrequency, FloatType value)>;
+  /** Returns the amplitude of the sine partial with the given number. */
+  using HarmonicsGenerator = std::function<FloatType(int harmonic)>;
+
+  /**
+   * Partials of an arbitrary waveform, indexed by their numbers: the real part
+   * is the cosine amplitude, and the imaginary part is the sine amplitude.
+   * The element at index 0 (the DC offset) is ignored.
+   */
+  using Spectrum = std::vector<std::complex<FloatType>>;
 
   static constexpr auto pi = MathConstants<FloatType>::pi;
 
+  static constexpr auto lowestOctaveFrequency = FloatType(20);
+  static constexpr auto numberOfOctaves = 11;
+
+  /** Partials that fold back above this frequency are considered inaudible. */
+  static constexpr auto maxAudibleFrequency = 20000.0;
+
 #pragma mark - Initialization
 
   MultibandLookupTable() = default;
 
-  void setTable(const TableGenerator &tableGenerator, int tableSize) {
-    forEachBand([=](int bandIndex) {
-      auto bandTableGenerator = [=](FloatType phase) {
-        auto maxFrequency = bandMaxFrequencies[bandIndex];
-        return tableGenerator(maxFrequency, phase);
-      };
+  /** Builds a channel for every generator. */
+  void setTable(const std::vector<HarmonicsGenerator> &harmonicsGenerators,
+                int tableSizeOrder, double sampleRate) {
+    buildTables((int)harmonicsGenerators.size(), tableSizeOrder, sampleRate,
+                [&](int channel, int harmonic) {
+                  return std::complex<FloatType>(
+                      0, harmonicsGenerators[channel](harmonic));
+                });
+  }
 
-      tables[bandIndex] =
-          std::make_unique<dsp::LookupTableTransform<FloatType>>(
-              bandTableGenerator, -pi, pi, tableSize);
-    });
+  /** Builds a channel for every spectrum. */
+  void setTable(const std::vector<Spectrum> &spectra, int tableSizeOrder,
+                double sampleRate) {
+    buildTables((int)spectra.size(), tableSizeOrder, sampleRate,
+                [&](int channel, int harmonic) {
+                  const auto &spectrum = spectra[channel];
+
+                  return (size_t)harmonic < spectrum.size()
+                             ? spectrum[(size_t)harmonic]
+                             : std::complex<FloatType>();
+                });
+  }
+
+  /**
+   * Uses tables that were generated before, e.g. read from a cache file.
+   * The samples aren't copied and must outlive this object.
+   */
+  void setTable(const FloatType *externalSamples, int channels,
+                int tableSizeOrder) {
+    tableSize = 1 << tableSizeOrder;
+    numberOfChannels = channels;
+    ownedSamples.clear();
+    samples = externalSamples;
+  }
+
+#pragma mark - Accessing Samples
+
+  /** Returns the number of samples of the tables of all octaves. */
+  static size_t numberOfSamples(int tableSizeOrder, int channels) {
+    return (size_t)(numberOfOctaves * ((1 << tableSizeOrder) + 1) * channels);
+  }
+
+  const FloatType *getSamples() const { return samples; }
+
+  int getNumChannels() const { return numberOfChannels; }
+
+  /**
+   * Returns the interleaved table of the given octave, with a guard point at
+   * the end. The sample of channel `c` at index `i` is at
+   * `i * getNumChannels() + c`.
+   */
+  const FloatType *octaveTable(int octave) const {
+    return samples + octave * (tableSize + 1) * numberOfChannels;
   }
 
 #pragma mark - Call Operator
 
-  FloatType operator()(FloatType phase, FloatType frequency) const {
-    assert(tables[0] != nullptr &&
-           "setTable() must be called before operator()");
+  FloatType operator()(FloatType phase, FloatType frequency,
+                       int channel) const {
+    assert(samples != nullptr && "setTable() must be called before operator()");
+    assert(channel < numberOfChannels);
+
+    auto position = phase * (tableSize / (2 * pi));
+    position -= std::floor(position / tableSize) * tableSize;
+
+    auto wholePosition = static_cast<int>(position);
+    auto fraction = position - wholePosition;
+    auto index = wholePosition & (tableSize - 1);
 
-    auto bandIndex = bandForFrequency(frequency);
+    int octave;
+    FloatType crossfade;
+    octaveForFrequency(frequency, octave, crossfade);
 
-    return (*tables[bandIndex])(phase);
+    auto value = interpolate(octaveTable(octave) + channel, index, fraction);
+
+    if (crossfade > 0) {
+      auto nextValue =
+          interpolate(octaveTable(octave + 1) + channel, index, fraction);
+      value += crossfade * (nextValue - value);
+    }
+
+    return value;
   }
 
-private:
-  using SingleBandLookupTable = dsp::LookupTableTransform<FloatType>;
+#pragma mark - Resolving Frequency Octave
+
+  /**
+   * Resolves the octave table that is band-limited for the given frequency,
+   * and the crossfade amount towards the next (darker) octave table.
+   *
+   * Octaves are a log2 scale, so they are read straight from the exponent
+   * bits of the frequency relative to the lowest octave, and the crossfade
+   * from its mantissa bits, in constant time.
+   */
+  static void octaveForFrequency(FloatType frequency, int &octave,
+                                 FloatType &crossfade) {
+    using Bits = std::conditional_t<sizeof(FloatType) == 8, uint64_t, uint32_t>;
+    constexpr auto mantissaBits = std::numeric_limits<FloatType>::digits - 1;
+    constexpr auto exponentBias = std::numeric_limits<FloatType>::max_exponent;
 
-#pragma mark - Bands Frequencies
+    Bits bits;
+    const FloatType ratio = frequency / lowestOctaveFrequency;
+    std::memcpy(&bits, &ratio, sizeof(bits));
 
-  static constexpr std::array bandMaxFrequencies = std::to_array<FloatType>({
-      60,   // Sub
-      250,  // Bass
-      500,  // LowMid
-      1000, //
-      2000, // Mid
-      3000, //
-      4000, // UpperMid
-      5000, //
-      6000, // Presence
-      20000 // Brilliance
-  });
+    // The sign is ignored, and zero ends up below the lowest octave.
+    const auto exponent =
+        static_cast<int>((bits >> mantissaBits) & (2 * exponentBias - 1));
+    const auto mantissa = bits & ((Bits(1) << mantissaBits) - 1);
 
-  static constexpr auto numberOfBands = bandMaxFrequencies.size();
+    octave = exponent - (exponentBias - 1);
+    crossfade = static_cast<FloatType>(mantissa) / (Bits(1) << mantissaBits);
 
+    if (octave < 0) {
+      octave = 0;
+      crossfade = 0;
+    } else if (octave >= numberOfOctaves - 1) {
+      octave = numberOfOctaves - 1;
+      crossfade = 0;
+    }
+  }
+
+private:
 #pragma mark - Private Members
 
-  std::array<std::unique_ptr<SingleBandLookupTable>, numberOfBands> tables;
+  int tableSize = 0;
+  int numberOfChannels = 0;
+
+  /** Interleaved tables of all octaves, each with a guard point at the end. */
+  const FloatType *samples = nullptr;
+  std::vector<FloatType> ownedSamples;
+
+#pragma mark - Building Tables
+
+  template <typename PartialGenerator>
+  void buildTables(int channels, int tableSizeOrder, double sampleRate,
+                   PartialGenerator &&partial) {
+    tableSize = 1 << tableSizeOrder;
+    numberOfChannels = channels;
+
+    ownedSamples.assign(numberOfSamples(tableSizeOrder, numberOfChannels), 0);
+    samples = ownedSamples.data();
+
+    const auto maxHarmonicFrequency =
+        jmax(0.5 * sampleRate, sampleRate - maxAudibleFrequency);
+
+    dsp::FFT fft(tableSizeOrder);
+    std::vector<float> fftData((size_t)(2 * tableSize));
+
+    forEachOctave([&](int octave) {
+      const auto octaveMaxFrequency =
+          lowestOctaveFrequency * std::pow(FloatType(2), octave + 1);
+      const auto numberOfHarmonics =
+          jlimit(1, tableSize / 2 - 1,
+                 static_cast<int>(maxHarmonicFrequency / octaveMaxFrequency));
 
-#pragma mark - Resolving Frequency Band
+      for (auto channel = 0; channel < numberOfChannels; channel++) {
+        std::fill(fftData.begin(), fftData.end(), 0.0f);
 
-  static constexpr int bandForFrequency(FloatType frequency) {
-    for (auto &maxFrequency : bandMaxFrequencies) {
-      auto bandIndex = &maxFrequency - &bandMaxFrequencies[0];
-      auto band = static_cast<int>(bandIndex);
+        // A partial a * cos + b * sin is the bin value (a - i * b) * N / 2,
+        // since the inverse transform is normalised by 1 / N.
+        for (auto harmonic = 1; harmonic <= numberOfHarmonics; harmonic++) {
+          const auto amplitude = partial(channel, harmonic);
 
-      if (frequency < maxFrequency) {
-        return band;
+          fftData[(size_t)(2 * harmonic)] =
+              0.5f * tableSize * (float)amplitude.real();
+          fftData[(size_t)(2 * harmonic + 1)] =
+              -0.5f * tableSize * (float)amplitude.imag();
+        }
+
+        fft.performRealOnlyInverseTransform(fftData.data());
+
+        auto *table = ownedSamples.data() +
+                      octave * (tableSize + 1) * numberOfChannels + channel;
+
+        for (auto i = 0; i < tableSize; i++)
+          table[i * numberOfChannels] = fftData[(size_t)i];
+
+        table[tableSize * numberOfChannels] = table[0];
       }
-    }
+    });
+  }
+
+#pragma mark - Interpolating
 
-    return numberOfBands - 1;
+  FloatType interpolate(const FloatType *table, int index,
+                        FloatType fraction) const {
+    const auto current = table[index * numberOfChannels];
+    const auto next = table[(index + 1) * numberOfChannels];
+
+    return current + fraction * (next - current);
   }
 
-#pragma mark - Iterating Frequency Bands
+#pragma mark - Iterating Octaves
 
-  void forEachBand(const std::function<void(int)> &fn) {
-    for (int band = 0; band < numberOfBands; band++) {
-      fn(band);
+  void forEachOctave(const std::function<void(int)> &fn) {
+    for (int octave = 0; octave < numberOfOctaves; octave++) {
+      fn(octave);
     }
   }
+
+  JUCE_DECLARE_NON_COPYABLE(MultibandLookupTable)
 };
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    ReleasePool.h
+    Created: 19 Oct 2026 10:42:15am
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Keeps the objects that the audio thread may still be reading alive after
+ * they're replaced, and frees them once it's done with them, never on the
+ * audio thread.
+ *
+ * The audio thread only calls `blockDidEnd()` after every block. An object
+ * retired while a block is rendering is freed after that block ends, by the
+ * next `retire()` or `releaseRetired()` call. The pool's owner should also
+ * call `releaseRetired()` periodically, since nothing may be retired again
+ * for a while.
+ *
+ * The audio thread must load the pointers to the objects it reads at the
+ * start of every block, and not keep them across blocks.
+ */
+class ReleasePool {
+public:
+#pragma mark - Audio Thread
+
+  void blockDidEnd() noexcept { numberOfEndedBlocks.fetch_add(1); }
+
+#pragma mark - Retiring Objects
+
+  /**
+   * Keeps the object alive until the block that is rendering now ends. Must
+   * be called after the audio thread can no longer load it.
+   */
+  void retire(std::shared_ptr<const void> object) {
+    releaseRetired();
+
+    if (object == nullptr)
+      return;
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    retiredObjects.push_back({numberOfEndedBlocks.load(), std::move(object)});
+  }
+
+  /** Frees the retired objects that the audio thread is done with. */
+  void releaseRetired() {
+    std::vector<std::shared_ptr<const void>> releasedObjects;
+
+    {
+      const std::lock_guard<std::mutex> lock(mutex);
+      const auto endedBlocks = numberOfEndedBlocks.load();
+
+      for (auto it = retiredObjects.begin(); it != retiredObjects.end();) {
+        if (it->endedBlocks == endedBlocks) {
+          ++it;
+          continue;
+        }
+
+        releasedObjects.push_back(std::move(it->object));
+        it = retiredObjects.erase(it);
+      }
+    }
+
+    // The objects are freed outside the lock, since it may take a while.
+  }
+
+private:
+  struct RetiredObject {
+    /** The number of ended blocks when the object was retired. */
+    uint64_t endedBlocks;
+    std::shared_ptr<const void> object;
+  };
+
+  std::atomic<uint64_t> numberOfEndedBlocks{0};
+
+  std::mutex mutex;
+  std::vector<RetiredObject> retiredObjects;
+};
@@ -0,0 +1,255 @@
+/*
+  ==============================================================================
+
+    RenderThreadPool.h
+    Created: 18 Oct 2026 11:21:48pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+#if JUCE_INTEL
+#include <emmintrin.h>
+#endif
+
+using namespace juce;
+
+/**
+ * A small pool of real-time worker threads that the audio thread hands
+ * rendering tasks to.
+ *
+ * `run()` publishes a batch of tasks, which the workers and the audio thread
+ * itself claim one at a time with a compare-and-swap. The audio thread never
+ * waits on a mutex: if the workers are late to wake up, it renders the tasks
+ * on its own, and it only spins for the tasks that workers have claimed and
+ * are still running.
+ *
+ * Idle workers spin for a while, so that back-to-back blocks are picked up
+ * right away, and then park until the next batch. Waking parked workers is
+ * the only time the audio thread takes a lock, and it's only held by workers
+ * that are about to park, for as long as they take to check for work.
+ */
+class RenderThreadPool {
+public:
+  /** How many times an idle worker checks for work before it parks. */
+  static constexpr auto spinIterations = 4096;
+
+  /**
+   * How many times the audio thread checks for the workers' last tasks before
+   * it starts yielding between checks.
+   */
+  static constexpr auto completionSpinIterations = 1024;
+
+  static constexpr auto maxNumberOfTasks = 0xffff;
+
+  ~RenderThreadPool() { stop(); }
+
+#pragma mark - Starting and Stopping
+
+  /**
+   * Starts the worker threads, stopping the current ones first if their
+   * number, the block size or the sample rate changes, since real-time
+   * threads are scheduled for the time a block takes. Mustn't be called while
+   * `run()` is running.
+   */
+  void start(int numberOfThreads, int maximumBlockSize, double sampleRate) {
+    if (numberOfThreads == (int)workers.size() &&
+        maximumBlockSize == startedBlockSize &&
+        sampleRate == startedSampleRate)
+      return;
+
+    stop();
+
+    startedBlockSize = maximumBlockSize;
+    startedSampleRate = sampleRate;
+
+    const auto options =
+        Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(
+            maximumBlockSize, sampleRate);
+
+    for (auto i = 0; i < numberOfThreads; i++) {
+      workers.push_back(std::make_unique<Worker>(*this));
+
+      if (!workers.back()->startRealtimeThread(options))
+        workers.back()->startThread(Thread::Priority::highest);
+    }
+  }
+
+  void stop() {
+    for (auto &worker : workers)
+      worker->signalThreadShouldExit();
+
+    wakeUpWorkers();
+
+    for (auto &worker : workers)
+      worker->stopThread(-1);
+
+    workers.clear();
+  }
+
+  int getNumberOfThreads() const { return (int)workers.size(); }
+
+#pragma mark - Running Tasks
+
+  /**
+   * Calls `task(index)` for every index below `numberOfTasks`, on the workers
+   * and the calling thread, and returns once all calls have returned. The
+   * order in which the tasks run is unspecified.
+   */
+  template <typename Task> void run(int numberOfTasks, Task &task) noexcept {
+    jassert(numberOfTasks <= maxNumberOfTasks);
+
+    if (numberOfTasks <= 0)
+      return;
+
+    taskFunction = [](void *context, int index) {
+      (*static_cast<Task *>(context))(index);
+    };
+    taskContext = &task;
+
+    completedTasks.store(0, std::memory_order_relaxed);
+
+    // Both this store and the load of `parkedWorkers` are sequentially
+    // consistent, so a worker that parks either sees the batch or is seen.
+    const auto generation = generationOf(jobState.load()) + 1;
+    jobState.store(uint64_t(generation) << 32 | uint64_t(numberOfTasks) << 16);
+
+    if (parkedWorkers.load() > 0)
+      wakeUpWorkers();
+
+    performTasks(generation);
+
+    // The remaining tasks are already running on the workers.
+    for (auto i = 0;
+         completedTasks.load(std::memory_order_acquire) < numberOfTasks; i++) {
+      if (i < completionSpinIterations)
+        pause();
+      else
+        std::this_thread::yield();
+    }
+  }
+
+private:
+  struct Worker : public Thread {
+    explicit Worker(RenderThreadPool &pool)
+        : Thread("BlackBird Voices"), pool(pool) {}
+
+    void run() override {
+      uint32_t seenGeneration = 0;
+
+      while (!threadShouldExit()) {
+        seenGeneration = pool.waitForTasks(*this, seenGeneration);
+        pool.performTasks(seenGeneration);
+      }
+    }
+
+    RenderThreadPool &pool;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  int startedBlockSize = 0;
+  double startedSampleRate = 0;
+
+  /**
+   * The batch's generation, its number of tasks and the next task to claim,
+   * which are updated together so that a late worker can never claim a task
+   * of a newer batch.
+   */
+  std::atomic<uint64_t> jobState{0};
+  std::atomic<int> completedTasks{0};
+
+  void (*taskFunction)(void *, int) = nullptr;
+  void *taskContext = nullptr;
+
+  std::mutex parkingMutex;
+  std::condition_variable parkingCondition;
+  std::atomic<int> parkedWorkers{0};
+
+  static uint32_t generationOf(uint64_t state) {
+    return uint32_t(state >> 32);
+  }
+
+  static int numberOfTasksOf(uint64_t state) {
+    return int((state >> 16) & maxNumberOfTasks);
+  }
+
+  static int taskIndexOf(uint64_t state) {
+    return int(state & maxNumberOfTasks);
+  }
+
+  /**
+   * Claims and performs the tasks of the given batch, until there are none
+   * left. Tasks of a newer batch are never claimed.
+   */
+  void performTasks(uint32_t generation) noexcept {
+    auto state = jobState.load(std::memory_order_acquire);
+
+    while (generationOf(state) == generation &&
+           taskIndexOf(state) < numberOfTasksOf(state)) {
+      if (!jobState.compare_exchange_weak(state, state + 1,
+                                          std::memory_order_acq_rel))
+        continue;
+
+      taskFunction(taskContext, taskIndexOf(state));
+      completedTasks.fetch_add(1, std::memory_order_release);
+
+      state = jobState.load(std::memory_order_acquire);
+    }
+  }
+
+  /** Spins, and then parks, until a batch newer than `seenGeneration`. */
+  uint32_t waitForTasks(Worker &worker, uint32_t seenGeneration) {
+    const auto currentGeneration = [this] {
+      return generationOf(jobState.load());
+    };
+
+    for (auto i = 0; i < spinIterations; i++) {
+      if (currentGeneration() != seenGeneration)
+        return currentGeneration();
+
+      pause();
+    }
+
+    // Registered and checked under the lock, which `wakeUpWorkers()` takes
+    // before notifying, so the notification can't come before the wait.
+    std::unique_lock<std::mutex> lock(parkingMutex);
+    parkedWorkers++;
+
+    while (currentGeneration() == seenGeneration &&
+           !worker.threadShouldExit())
+      parkingCondition.wait(lock);
+
+    parkedWorkers--;
+
+    return currentGeneration();
+  }
+
+  void wakeUpWorkers() {
+    // Waits for the workers that are about to park to start waiting.
+    {
+      const std::lock_guard<std::mutex> lock(parkingMutex);
+    }
+
+    parkingCondition.notify_all();
+  }
+
+  /** Tells the CPU that the thread is spinning. */
+  static void pause() noexcept {
+#if JUCE_INTEL
+    _mm_pause();
+#elif JUCE_ARM && (JUCE_CLANG || JUCE_GCC)
+    __asm__ __volatile__("yield");
+#endif
+  }
+};
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    StaticTables.h
+    Created: 18 Oct 2026 6:02:19pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cmath>
+
+/** Compile-time implementations of math functions, for generating tables. */
+struct ConstexprMath {
+  static constexpr double pi = 3.141592653589793238;
+
+  /** Taylor series of sine, accurate to double precision within a period. */
+  static constexpr double sin(double x) {
+    x -= 2 * pi * static_cast<long long>(x / (2 * pi));
+
+    if (x > pi)
+      x -= 2 * pi;
+    else if (x < -pi)
+      x += 2 * pi;
+
+    auto term = x;
+    auto sum = x;
+
+    for (auto n = 1; n < 13; n++) {
+      term *= -x * x / ((2 * n) * (2 * n + 1));
+      sum += term;
+    }
+
+    return sum;
+  }
+};
+
+/**
+ * Linearly interpolated table of one period of a 2pi-periodic function,
+ * generated at compile time.
+ *
+ * The samples are laid out like `MultibandLookupTable`'s octave tables, with a
+ * guard point at the end, so oscillators can read them the same way.
+ */
+template <typename FloatType, int SizeOrder> class PeriodicTable {
+public:
+  static constexpr auto size = 1 << SizeOrder;
+
+  template <typename Function>
+  constexpr explicit PeriodicTable(Function &&function) : samples() {
+    for (auto i = 0; i < size; i++)
+      samples[i] =
+          static_cast<FloatType>(function(2 * ConstexprMath::pi * i / size));
+
+    samples[size] = samples[0];
+  }
+
+  constexpr const FloatType *data() const { return samples.data(); }
+
+  /** Returns the function's value at `x`, in radians. */
+  FloatType operator()(FloatType x) const noexcept {
+    auto position = x * static_cast<FloatType>(size / (2 * ConstexprMath::pi));
+    position -= std::floor(position / size) * size;
+
+    const auto index = static_cast<int>(position) & (size - 1);
+    const auto fraction = position - std::floor(position);
+
+    return samples[index] + fraction * (samples[index + 1] - samples[index]);
+  }
+
+private:
+  std::array<FloatType, size + 1> samples;
+};
+
+/**
+ * One period of sine, from 0 to 2pi. Being static data, it is shared by all
+ * oscillators, LFOs and plugin instances, and is never built at runtime.
+ */
+template <typename FloatType, int SizeOrder>
+inline constexpr PeriodicTable<FloatType, SizeOrder>
+    sineTable(ConstexprMath::sin);
@@ -10,13 +10,33 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "FdnReverb.h"
 #include "LookupTablesBank.h"
+#include "LookupTablesRegistry.h"
+#include "ReleasePool.h"
+#include "RenderThreadPool.h"
 #include "Voice.h"
 #include "juce_audio_basics/juce_audio_basics.h"
 
 using namespace juce;
 
-class Synth : public Synthesiser {
+/**
+ * The synth's voice engine: it parses the MIDI, allocates the voices and
+ * renders them.
+ *
+ * Everything runs on the audio thread, which never takes a lock. Voices are
+ * called directly rather than through virtual functions, and only the
+ * allocated ones are visited, in a flat array.
+ */
+class Synth {
 public:
 #pragma mark - Static Properties
 
@@ -47,94 +67,1129 @@ public:
 
   static constexpr auto defaultReverb = 0.0f;
   static constexpr auto defaultMasterGain = 1.0f;
+  static constexpr auto defaultStereoSpread = Voice::defaultStereoSpread;
+
+  static constexpr auto defaultPolyphony = 5;
+
+#pragma mark - Polyphony
+
+  /** All voices are allocated up front, so polyphony changes never allocate. */
+  static constexpr auto maxPolyphony = 64;
+
+#pragma mark - MIDI
+
+  static constexpr auto numberOfMidiChannels = 16;
+
+  static constexpr auto defaultMinimumSubBlockSize = 32;
+  static constexpr auto defaultMidiCoalescingWindow = 32;
+
+  /**
+   * MIDI events other than notes that are closer than this to the previous
+   * split are handled before it, rather than splitting the block, which
+   * bounds the number of sub-blocks in dense controller streams. Notes
+   * always split the block, so they stay sample-accurate.
+   */
+  void setMinimumSubBlockSize(int numSamples) {
+    minimumSubBlockSize = jmax(1, numSamples);
+  }
+
+  /**
+   * Within every window of this many samples, only the last pitch wheel
+   * message and the last value of every continuous controller of a channel
+   * are handled, unless a note or another message of the channel comes in
+   * between. 0 handles every message.
+   */
+  void setMidiCoalescingWindow(int numSamples) {
+    midiCoalescingWindow = jmax(0, numSamples);
+  }
 
 #pragma mark - Construction
 
   explicit Synth(DSPParameters &parameters) : parameters(parameters) {
-    for (auto i = 0; i < maxNumVoices; ++i) {
-      addVoice(new Voice(parameters));
-    }
+    parameters.updateSnapshot(parametersSnapshot);
+
+    for (auto &snapshot : channelSnapshots)
+      parameters.updateSnapshot(snapshot);
+
+    for (size_t i = 0; i < voices.size(); i++)
+      voices[i] = std::make_unique<Voice>(channelSnapshots.front(), (int)i);
+
+    resetVoicePool();
+
+    lastPitchWheelValues.fill(0x2000);
+  }
+
+#pragma mark - Multi-Timbral Mode
+
+  /**
+   * Makes the notes of the MIDI channel play with their own parameters, e.g.
+   * a preset's, instead of the synth's. Passing nullptr makes the channel
+   * follow the synth's parameters again.
+   *
+   * The channels share the voices, the lookup tables and the master effects,
+   * so the polyphony, reverb and master gain are always the synth's.
+   *
+   * The parameters are swapped in with a single pointer, so a block never
+   * reads a mix of the old and the new ones. They mustn't change once
+   * they're set, and are kept alive until the audio thread is done with
+   * them. Must not be called from the audio thread.
+   */
+  void setChannelParameters(
+      int midiChannel,
+      std::shared_ptr<const DSPParameters> newChannelParameters) {
+    jassert(midiChannel > 0 && midiChannel <= numberOfMidiChannels);
 
-    addSound(new Sound());
+    const std::lock_guard<std::mutex> lock(channelParametersMutex);
+    auto &owner = channelParametersOwners[(size_t)midiChannel - 1];
+
+    channelParameters[(size_t)midiChannel - 1].store(
+        newChannelParameters.get());
+
+    releasePool->retire(std::move(owner));
+    owner = std::move(newChannelParameters);
+  }
+
+#pragma mark - Voice Stealing
+
+  /**
+   * When enabled, a note played with all voices busy steals the quietest
+   * one. Otherwise, the note is ignored.
+   */
+  void setNoteStealingEnabled(bool shouldSteal) {
+    noteStealingEnabled = shouldSteal;
   }
 
+  bool isNoteStealingEnabled() const { return noteStealingEnabled; }
+
+#pragma mark - Releasing Replaced Objects
+
+  /**
+   * Frees the lookup tables and channel parameters that have been replaced,
+   * once the audio thread is done with them. Replacing them frees the older
+   * ones too, so this only needs to be called every second or so, off the
+   * audio thread, e.g. from a timer.
+   */
+  void releaseReplacedObjects() { releasePool->releaseRetired(); }
+
+#pragma mark - Caching Lookup Tables
+
+  /** Sets the file where generated lookup tables are cached across sessions. */
+  void setLookupTablesCacheFile(const File &file) {
+    lookupTablesCacheFile = file;
+  }
+
+  /**
+   * When enabled, `prepare()` doesn't wait for lookup tables that aren't
+   * cached to be built. Voices use the fallback waveforms until the tables are
+   * ready, and pick them up at the next block boundary.
+   */
+  void setBuildsLookupTablesAsynchronously(bool shouldBuildAsynchronously) {
+    buildsLookupTablesAsynchronously = shouldBuildAsynchronously;
+  }
+
+#pragma mark - User Wavetables
+
+  /**
+   * Makes the oscillators play the wavetable imported from the given WAV file,
+   * or the built-in waveforms if the file is empty or can't be imported.
+   *
+   * The wavetable's tables are cached next to the file, in a file with the
+   * `wavetableCacheExtension`. When they aren't cached, they're built on a
+   * background thread, so this never waits for a build, and the built-in
+   * waveforms are played until they are ready. Only `prepare()` waits for
+   * them, if the synth builds its tables synchronously. The PolyBLEP engine
+   * always plays the built-in waveforms.
+   */
+  void setUserWavetable(const File &wavetableFile) {
+    if (wavetableFile == userWavetableFile)
+      return;
+
+    userWavetableFile = wavetableFile;
+
+    if (getSampleRate() > 0)
+      acquireUserWavetableBank(getSampleRate(), true);
+  }
+
+  const File &getUserWavetable() const { return userWavetableFile; }
+
+  static constexpr auto wavetableCacheExtension = ".tables";
+
+#pragma mark - Multithreaded Rendering
+
+  /**
+   * Not measured on many cores yet. The benchmarks app's "Render Threads"
+   * shows where the threads start paying off on a machine.
+   */
+  static constexpr auto defaultMultithreadingThreshold = 16;
+
+  /**
+   * Sets the number of worker threads that render voices alongside the audio
+   * thread, or 0 to render on the audio thread only. The threads are started
+   * by the next `startRenderThreads()`.
+   */
+  void setNumberOfRenderThreads(int numberOfThreads) {
+    numberOfRenderThreads = jmax(0, numberOfThreads);
+  }
+
+  /**
+   * Voices are only rendered on the worker threads when at least this many
+   * are allocated. With fewer voices, handing them over costs more than
+   * rendering them in parallel saves.
+   */
+  void setMultithreadingThreshold(int numberOfVoices) {
+    multithreadingThreshold = jmax(1, numberOfVoices);
+  }
+
+  /**
+   * Starts or stops worker threads to match `setNumberOfRenderThreads()`,
+   * with the sample rate and block size of the last `prepare()`. Call it
+   * after `prepare()`, while no block is rendering. Unlike `prepare()`, it
+   * creates threads, so it may throw.
+   */
+  void startRenderThreads() {
+    renderThreadPool.start(numberOfRenderThreads, maximumBlockSize,
+                           getSampleRate());
+  }
+
+  /**
+   * Stops the worker threads until the next `startRenderThreads()`. Call it
+   * while no block is rendering, e.g. when playback stops.
+   */
+  void stopRenderThreads() { renderThreadPool.stop(); }
+
+  int getNumberOfRenderThreads() const { return numberOfRenderThreads; }
+
+#pragma mark - Control Rate
+
+  /**
+   * Sets the rate of the voices' control updates, in Hz, which takes effect
+   * at the next `prepare()`. Being set in time rather than in samples, it
+   * costs the same at any sample rate.
+   */
+  void setControlRate(double newControlRateHz) {
+    jassert(newControlRateHz > 0);
+    controlRateHz = newControlRateHz;
+  }
+
+  double getControlRate() const { return controlRateHz; }
+
 #pragma mark - Preparing for Operation
 
   void prepare(const dsp::ProcessSpec &spec) noexcept {
-    setCurrentPlaybackSampleRate(spec.sampleRate);
+    sampleRate = spec.sampleRate;
 
-    lookupTablesBank.initialize(spec.sampleRate);
+    acquireLookupTablesBank(spec.sampleRate);
+    acquireUserWavetableBank(spec.sampleRate,
+                             buildsLookupTablesAsynchronously);
 
-    for (auto *genericVoice : voices) {
-      auto *voice = dynamic_cast<Voice *>(genericVoice);
+    voicesLookupTablesBank = publishedLookupTablesBank();
 
-      voice->prepare(spec, lookupTablesBank);
+    controlBlockSize =
+        (size_t)jmax(1, roundToInt(spec.sampleRate / controlRateHz));
+
+    filterCutoffTable.prepare(spec.sampleRate, minCutoff, maxCutoff);
+
+    // Voices render in mono, one at a time, into the same scratch block.
+    tempBlock = dsp::AudioBlock<float>(heapBlock, 1, spec.maximumBlockSize);
+
+    for (auto &voice : voices) {
+      voice->setFilterCutoffTable(&filterCutoffTable);
+      voice->prepare(spec, voicesLookupTablesBank, tempBlock,
+                     controlBlockSize);
     }
 
-    tempBlock = dsp::AudioBlock<float>(heapBlock, spec.numChannels,
-                                       spec.maximumBlockSize);
+    resetVoicePool();
+
+    maximumBlockSize = (int)spec.maximumBlockSize;
 
-    fxChain.prepare(spec);
+    // Slots take whole cache lines, so that workers never write to the same
+    // line.
+    voiceSlotStride = roundedToCacheLines(spec.maximumBlockSize);
+
+    voiceSlotStorage.allocate(maxPolyphony * voiceSlotStride +
+                                  floatsPerCacheLine,
+                              true);
+    voiceSlots = alignedToCacheLine(voiceSlotStorage.get());
+
+    reverb.prepare(spec);
+    reverb.resetOutputMix(lastMasterGain * (1.0f - lastReverbLevel),
+                          lastMasterGain * lastReverbLevel);
   }
 
+  double getSampleRate() const { return sampleRate; }
+
 #pragma mark - Reverb
 
-  inline bool reverbIsOn() const { return *parameters.reverb != 0.0f; }
+  inline bool reverbIsOn() const { return parametersSnapshot.reverb != 0.0f; }
 
-private:
-  static constexpr auto maxNumVoices = 5;
+#pragma mark - Rendering
+
+  /**
+   * Takes the parameters snapshot for the block, and then renders it, split
+   * at the MIDI events, which are handled in between.
+   */
+  void renderNextBlock(AudioBuffer<float> &outputAudio,
+                       const MidiBuffer &inputMidi, int startSample,
+                       int numSamples) {
+    updateVoicesLookupTablesBank();
+    updateParametersSnapshot();
+
+    auto midiIterator = inputMidi.findNextSamplePosition(startSample);
+    const auto endSample = startSample + numSamples;
+
+    findSupersededMidiEvents(midiIterator, inputMidi.cend(), startSample,
+                             endSample);
+
+    // Like `juce::Synthesiser`, the first event can split the block anywhere.
+    auto isFirstSplit = true;
+    auto eventIndex = 0;
+
+    for (; midiIterator != inputMidi.cend(); ++midiIterator, ++eventIndex) {
+      const auto event = *midiIterator;
+
+      if (event.samplePosition >= endSample)
+        break;
+
+      if (eventIndex < maxCoalescedMidiEvents &&
+          supersededMidiEvents[(size_t)eventIndex])
+        continue;
+
+      const auto minimumSplitSize =
+          isFirstSplit || isNoteEvent(event.data, event.numBytes)
+              ? 1
+              : minimumSubBlockSize;
+
+      if (event.samplePosition - startSample >= minimumSplitSize) {
+        renderVoices(outputAudio, startSample,
+                     event.samplePosition - startSample);
+
+        startSample = event.samplePosition;
+        isFirstSplit = false;
+      }
+
+      handleMidiEvent(event.data, event.numBytes);
+    }
+
+    if (startSample < endSample)
+      renderVoices(outputAudio, startSample, endSample - startSample);
+
+    for (; midiIterator != inputMidi.cend(); ++midiIterator) {
+      const auto event = *midiIterator;
+      handleMidiEvent(event.data, event.numBytes);
+    }
+
+    releasePool->blockDidEnd();
+  }
+
+#pragma mark - Playing Notes
+
+  /** These must be called on the audio thread, between blocks. */
+  void noteOn(int midiChannel, int midiNoteNumber, float velocity) {
+    jassert(midiChannel > 0 && midiChannel <= numberOfMidiChannels);
+
+    // If hitting a note that's still ringing, stop it first (it could be
+    // still playing because of the sustain or sostenuto pedal).
+    if (auto *ringingVoice = voiceForNote(midiChannel, midiNoteNumber))
+      ringingVoice->stopNote(1.0f, true);
+
+    auto *voice = allocateVoice();
+    noteVoice(midiChannel, midiNoteNumber) = voice;
+
+    if (voice == nullptr)
+      return;
+
+    // Consecutive notes are spread to alternate sides.
+    nextStereoSide = -nextStereoSide;
+    voice->setStereoSide(nextStereoSide);
+
+    // A stolen voice is cut off right away.
+    if (voice->isVoiceActive())
+      voice->stopNote(0.0f, false);
+
+    // Channels without voices aren't updated, so they catch up first.
+    if (channelSnapshotStates[(size_t)midiChannel - 1].lastUpdatedBlock !=
+        blockNumber)
+      updateChannelSnapshot((size_t)midiChannel - 1);
+
+    voice->setParameters(channelSnapshots[(size_t)midiChannel - 1]);
+    voice->startNote(midiChannel, midiNoteNumber, velocity,
+                     lastPitchWheelValues[(size_t)midiChannel - 1],
+                     ++lastNoteOnTime);
+
+    voice->setSostenutoPedalDown(false);
+    voice->setSustainPedalDown(sustainPedalsDown[(size_t)midiChannel]);
+  }
+
+  void noteOff(int midiChannel, int midiNoteNumber, float velocity,
+               bool allowTailOff) {
+    auto *voice = voiceForNote(midiChannel, midiNoteNumber);
+    if (voice == nullptr)
+      return;
+
+    voice->setKeyDown(false);
+
+    if (!(voice->isSustainPedalDown() || voice->isSostenutoPedalDown()))
+      voice->stopNote(velocity, allowTailOff);
+  }
+
+  /** Stops the notes of the channel, or of all channels if it's 0. */
+  void allNotesOff(int midiChannel, bool allowTailOff) {
+    for (auto i = 0; i < numberOfAllocatedVoices; i++) {
+      auto *voice = allocatedVoices[(size_t)i];
 
+      if (midiChannel <= 0 || voice->isPlayingChannel(midiChannel))
+        voice->stopNote(1.0f, allowTailOff);
+    }
+
+    sustainPedalsDown.fill(false);
+  }
+
+private:
   DSPParameters &parameters;
 
-  enum {
-    reverbIndex,
-    reverbGainIndex,
+  double sampleRate = 0;
+  int maximumBlockSize = 0;
+
+  /** The synth-wide parameters, e.g. polyphony, reverb and master gain. */
+  DSPParametersSnapshot parametersSnapshot;
+
+  /**
+   * The parameters of every MIDI channel, read by the voices playing it.
+   * They're the synth's parameters, unless the channel has its own.
+   */
+  std::array<DSPParametersSnapshot, numberOfMidiChannels> channelSnapshots;
+  std::array<std::atomic<const DSPParameters *>, numberOfMidiChannels>
+      channelParameters{};
+
+  /** Own the channels' parameters. Never accessed on the audio thread. */
+  std::array<std::shared_ptr<const DSPParameters>, numberOfMidiChannels>
+      channelParametersOwners;
+  std::mutex channelParametersMutex;
+
+  struct ChannelSnapshotState {
+    /** The channel's parameters when it was last updated, or the synth's. */
+    const DSPParameters *source = nullptr;
+    uint64_t lastUpdatedBlock = 0;
   };
 
+  std::array<ChannelSnapshotState, numberOfMidiChannels>
+      channelSnapshotStates{};
+
+  /** Counts the blocks, so snapshots know when they were last updated. */
+  uint64_t blockNumber = 0;
+
   HeapBlock<char> heapBlock;
   dsp::AudioBlock<float> tempBlock;
 
   float lastMasterGain = *parameters.masterGain;
-  float lastReverbGain = *parameters.reverb;
+  float lastReverbLevel = *parameters.reverb;
+
+  using SharedLookupTablesBank = LookupTablesRegistry<float>::SharedBank;
+
+  /** Frees the banks the audio thread may still be reading. */
+  std::shared_ptr<ReleasePool> releasePool = std::make_shared<ReleasePool>();
+
+  /**
+   * Hands lookup tables banks over from the thread that acquired them to the
+   * audio thread. It's shared with the background build, so the build can
+   * finish safely after this synth is gone.
+   *
+   * Replaced banks are retired to the release pool, since the voices keep
+   * reading them until the end of the block.
+   */
+  struct LookupTablesHandoff {
+    std::mutex mutex;
+    SharedLookupTablesBank bank;
+    std::atomic<const LookupTablesBank<float> *> publishedBank{nullptr};
+    uint32_t generation = 0;
+
+    /** Null once the synth is gone, and so is its audio thread. */
+    std::weak_ptr<ReleasePool> releasePool;
+
+    explicit LookupTablesHandoff(std::weak_ptr<ReleasePool> releasePool)
+        : releasePool(std::move(releasePool)) {}
+
+    /** Starts waiting for a new bank and returns the generation to publish. */
+    uint32_t reset() {
+      const std::lock_guard<std::mutex> lock(mutex);
+
+      retireBank();
+
+      return ++generation;
+    }
+
+    /** Publishes the bank, unless it was requested by an outdated prepare. */
+    void publish(SharedLookupTablesBank newBank, uint32_t bankGeneration) {
+      const std::lock_guard<std::mutex> lock(mutex);
+
+      if (bankGeneration != generation)
+        return;
+
+      retireBank();
+
+      bank = std::move(newBank);
+      publishedBank.store(bank.get());
+    }
+
+  private:
+    void retireBank() {
+      publishedBank.store(nullptr);
+
+      if (auto pool = releasePool.lock())
+        pool->retire(std::move(bank));
+
+      bank = nullptr;
+    }
+  };
+
+  using SharedLookupTablesHandoff = std::shared_ptr<LookupTablesHandoff>;
+
+  SharedResourcePointer<LookupTablesRegistry<float>> lookupTablesRegistry;
+  SharedLookupTablesHandoff lookupTablesHandoff =
+      std::make_shared<LookupTablesHandoff>(releasePool);
+  SharedLookupTablesHandoff userWavetableHandoff =
+      std::make_shared<LookupTablesHandoff>(releasePool);
+
+  /**
+   * The bank the voices currently use. Accessed on the audio thread only, and
+   * loaded at the start of every block, so that a replaced bank is never read
+   * after the block it was retired in.
+   */
+  const LookupTablesBank<float> *voicesLookupTablesBank = nullptr;
+
+  File lookupTablesCacheFile;
+  File userWavetableFile;
+  bool buildsLookupTablesAsynchronously = false;
+
+  FdnReverb reverb;
+
+  LadderFilterCutoffTable filterCutoffTable;
+
+  double controlRateHz = Voice::defaultControlRateHz;
+  size_t controlBlockSize = 1;
+
+  RenderThreadPool renderThreadPool;
+  int numberOfRenderThreads = 0;
+  int multithreadingThreshold = defaultMultithreadingThreshold;
+
+  static constexpr size_t cacheLineSize = 64;
+  static constexpr size_t floatsPerCacheLine = cacheLineSize / sizeof(float);
+
+  /**
+   * The voices' outputs when they're rendered on the worker threads, a slot
+   * per allocated voice, in the order they were allocated.
+   */
+  HeapBlock<float> voiceSlotStorage;
+  float *voiceSlots = nullptr;
+  size_t voiceSlotStride = 0;
+
+  /**
+   * The number of samples rendered into a slot. Every slot's count has its
+   * own cache line, so that workers never write to the same line.
+   */
+  struct alignas(cacheLineSize) VoiceSlotSamples {
+    int numSamples = 0;
+  };
+
+  std::array<VoiceSlotSamples, maxPolyphony> voiceSlotSamples{};
+
+  /** Voices that aren't playing, ready to be allocated. */
+  std::array<Voice *, maxPolyphony> freeVoices{};
+  int numberOfFreeVoices = 0;
+
+  /** Voices that have been allocated and may still be playing. */
+  std::array<Voice *, maxPolyphony> allocatedVoices{};
+  int numberOfAllocatedVoices = 0;
+
+  /** The voice that was last started for every note of every channel. */
+  std::array<std::array<Voice *, 128>, numberOfMidiChannels> noteVoices{};
+
+  float nextStereoSide = 1.0f;
+
+  bool noteStealingEnabled = true;
+  uint32_t lastNoteOnTime = 0;
+
+  std::array<int, numberOfMidiChannels> lastPitchWheelValues{};
+
+  /** Indexed by MIDI channel, from 1. */
+  std::array<bool, numberOfMidiChannels + 1> sustainPedalsDown{};
+
+  std::array<std::unique_ptr<Voice>, maxPolyphony> voices;
+
+  int minimumSubBlockSize = defaultMinimumSubBlockSize;
+  int midiCoalescingWindow = defaultMidiCoalescingWindow;
+
+#pragma mark - Coalescing MIDI
+
+  static constexpr auto pitchWheelKey = 128;
+
+  static bool isNoteEvent(const uint8 *data, int numBytes) {
+    const auto status = numBytes > 0 ? data[0] & 0xf0 : 0;
+    return status == 0x80 || status == 0x90;
+  }
 
-  LookupTablesBank<float> lookupTablesBank;
+  /**
+   * Returns the controller number of a message whose last value is all that
+   * matters, or `pitchWheelKey` for pitch wheel messages, or -1 otherwise.
+   *
+   * Switches, data entry, (N)RPN selection and channel mode messages depend
+   * on every message, so they're never coalesced.
+   */
+  static int coalescingKey(const uint8 *data, int numBytes) {
+    if (numBytes < 3)
+      return -1;
 
-  dsp::ProcessorChain<dsp::Reverb, dsp::Gain<float>> fxChain;
+    const auto status = data[0] & 0xf0;
+
+    if (status == 0xe0)
+      return pitchWheelKey;
+
+    if (status != 0xb0)
+      return -1;
+
+    const auto number = (int)data[1];
+    const auto isKept = number == 6 || number == 38 ||
+                        (number >= 64 && number <= 69) ||
+                        (number >= 96 && number <= 101) || number >= 120;
+
+    return isKept ? -1 : number;
+  }
+
+  /** Events past this many in a block are never coalesced. */
+  static constexpr auto maxCoalescedMidiEvents = 4096;
+
+  /** Flags, by index in the block, the events whose value is replaced. */
+  std::bitset<maxCoalescedMidiEvents> supersededMidiEvents;
+
+  /**
+   * The last event of every channel and key, and the segment of the channel
+   * it was seen in. Segments end with the windows and with the messages that
+   * aren't coalesced, and are never reused, so stale entries never match.
+   */
+  struct CoalescedMidiEvent {
+    int index = 0;
+    uint64 segment = 0;
+  };
+
+  std::array<std::array<CoalescedMidiEvent, pitchWheelKey + 1>,
+             numberOfMidiChannels>
+      lastCoalescedMidiEvents{};
+
+  std::array<uint64, numberOfMidiChannels> channelSegments{};
+  uint64 lastSegment = 0;
+
+  /**
+   * Flags the events that a later message of the same channel and key in the
+   * same coalescing window replaces, with no other message of the channel in
+   * between. Windows are counted from the block's start and end with it.
+   *
+   * Visits every event of the block once.
+   */
+  void findSupersededMidiEvents(MidiBufferIterator event,
+                                MidiBufferIterator end, int blockStartSample,
+                                int blockEndSample) {
+    supersededMidiEvents.reset();
+
+    if (midiCoalescingWindow == 0)
+      return;
+
+    auto windowIndex = -1;
+
+    for (auto index = 0; event != end && index < maxCoalescedMidiEvents;
+         ++event, ++index) {
+      const auto metadata = *event;
+
+      if (metadata.samplePosition >= blockEndSample)
+        break;
+
+      const auto eventWindowIndex =
+          (metadata.samplePosition - blockStartSample) / midiCoalescingWindow;
+
+      if (eventWindowIndex != windowIndex) {
+        windowIndex = eventWindowIndex;
+        channelSegments.fill(++lastSegment);
+      }
+
+      // System messages don't belong to any channel.
+      if (metadata.numBytes < 1 || (metadata.data[0] & 0xf0) == 0xf0)
+        continue;
+
+      const auto channel = (size_t)(metadata.data[0] & 0x0f);
+      const auto key = coalescingKey(metadata.data, metadata.numBytes);
+
+      if (key < 0) {
+        channelSegments[channel] = ++lastSegment;
+        continue;
+      }
+
+      auto &last = lastCoalescedMidiEvents[channel][(size_t)key];
+
+      if (last.segment == channelSegments[channel])
+        supersededMidiEvents[(size_t)last.index] = true;
+
+      last = {index, channelSegments[channel]};
+    }
+  }
+
+#pragma mark - Handling MIDI
+
+  void handleMidiEvent(const uint8 *data, int numBytes) {
+    if (numBytes < 1)
+      return;
+
+    const auto status = data[0] & 0xf0;
+    const auto midiChannel = (data[0] & 0x0f) + 1;
+    const auto firstByte = numBytes > 1 ? (int)data[1] : 0;
+    const auto secondByte = numBytes > 2 ? (int)data[2] : 0;
+
+    switch (status) {
+    case 0x90:
+      if (secondByte > 0) {
+        noteOn(midiChannel, firstByte, (float)secondByte * (1.0f / 127.0f));
+        break;
+      }
+
+      noteOff(midiChannel, firstByte, 0.0f, true);
+      break;
+    case 0x80:
+      noteOff(midiChannel, firstByte, (float)secondByte * (1.0f / 127.0f),
+              true);
+      break;
+    case 0xb0:
+      handleController(midiChannel, firstByte, secondByte);
+      break;
+    case 0xe0:
+      handlePitchWheel(midiChannel, firstByte | (secondByte << 7));
+      break;
+    default:
+      // Aftertouch, program changes and system messages aren't used.
+      break;
+    }
+  }
+
+  void handleController(int midiChannel, int controllerNumber, int value) {
+    switch (controllerNumber) {
+    case 0x40:
+      handleSustainPedal(midiChannel, value >= 64);
+      break;
+    case 0x42:
+      handleSostenutoPedal(midiChannel, value >= 64);
+      break;
+    case 0x78: // All Sound Off
+    case 0x7b: // All Notes Off
+      allNotesOff(midiChannel, true);
+      return;
+    default:
+      break;
+    }
+
+    for (auto i = 0; i < numberOfAllocatedVoices; i++) {
+      auto *voice = allocatedVoices[(size_t)i];
+
+      if (voice->isPlayingChannel(midiChannel))
+        voice->controllerMoved(controllerNumber, value);
+    }
+  }
+
+  void handlePitchWheel(int midiChannel, int wheelValue) {
+    lastPitchWheelValues[(size_t)midiChannel - 1] = wheelValue;
+
+    for (auto i = 0; i < numberOfAllocatedVoices; i++) {
+      auto *voice = allocatedVoices[(size_t)i];
+
+      if (voice->isPlayingChannel(midiChannel))
+        voice->pitchWheelMoved(wheelValue);
+    }
+  }
+
+  void handleSustainPedal(int midiChannel, bool isDown) {
+    sustainPedalsDown[(size_t)midiChannel] = isDown;
+
+    for (auto i = 0; i < numberOfAllocatedVoices; i++) {
+      auto *voice = allocatedVoices[(size_t)i];
+
+      if (!voice->isPlayingChannel(midiChannel))
+        continue;
+
+      if (isDown) {
+        if (voice->isKeyDown())
+          voice->setSustainPedalDown(true);
+
+        continue;
+      }
+
+      voice->setSustainPedalDown(false);
+
+      if (!(voice->isKeyDown() || voice->isSostenutoPedalDown()))
+        voice->stopNote(1.0f, true);
+    }
+  }
+
+  void handleSostenutoPedal(int midiChannel, bool isDown) {
+    for (auto i = 0; i < numberOfAllocatedVoices; i++) {
+      auto *voice = allocatedVoices[(size_t)i];
+
+      if (!voice->isPlayingChannel(midiChannel))
+        continue;
+
+      if (isDown)
+        voice->setSostenutoPedalDown(true);
+      else if (voice->isSostenutoPedalDown())
+        voice->stopNote(1.0f, true);
+    }
+  }
+
+#pragma mark - Allocating Voices
+
+  void resetVoicePool() {
+    numberOfFreeVoices = 0;
+    numberOfAllocatedVoices = 0;
+
+    for (auto &voice : voices)
+      freeVoices[(size_t)numberOfFreeVoices++] = voice.get();
+
+    for (auto &channelNoteVoices : noteVoices)
+      channelNoteVoices.fill(nullptr);
+  }
+
+  int currentPolyphony() const {
+    return jlimit(1, maxPolyphony, roundToInt(parametersSnapshot.polyphony));
+  }
+
+  /**
+   * Takes a voice from the free list, or steals the quietest one if the
+   * polyphony is exhausted. Returns nullptr if stealing is disabled.
+   *
+   * Voices release themselves on the audio thread, and are moved back to the
+   * free list after every block, or right away when the pool runs out.
+   */
+  Voice *allocateVoice() {
+    const auto polyphony = currentPolyphony();
+
+    if (numberOfAllocatedVoices >= polyphony)
+      reclaimFinishedVoices();
+
+    if (numberOfAllocatedVoices < polyphony) {
+      auto *voice = freeVoices[(size_t)--numberOfFreeVoices];
+      allocatedVoices[(size_t)numberOfAllocatedVoices++] = voice;
+
+      return voice;
+    }
+
+    if (!isNoteStealingEnabled())
+      return nullptr;
+
+    return findQuietestVoice();
+  }
+
+  /** Moves the voices that finished playing back to the free list. */
+  void reclaimFinishedVoices() {
+    for (auto i = 0; i < numberOfAllocatedVoices;) {
+      auto *voice = allocatedVoices[(size_t)i];
+
+      if (voice->isVoiceActive()) {
+        i++;
+        continue;
+      }
+
+      allocatedVoices[(size_t)i] =
+          allocatedVoices[(size_t)--numberOfAllocatedVoices];
+      freeVoices[(size_t)numberOfFreeVoices++] = voice;
+    }
+  }
+
+  Voice *findQuietestVoice() const {
+    Voice *quietestVoice = nullptr;
+
+    for (auto i = 0; i < numberOfAllocatedVoices; i++) {
+      auto *voice = allocatedVoices[(size_t)i];
+
+      if (quietestVoice == nullptr ||
+          voice->getEnvelopeLevel() < quietestVoice->getEnvelopeLevel() ||
+          (voice->getEnvelopeLevel() == quietestVoice->getEnvelopeLevel() &&
+           voice->wasStartedBefore(*quietestVoice)))
+        quietestVoice = voice;
+    }
+
+    return quietestVoice;
+  }
+
+  Voice *&noteVoice(int midiChannel, int midiNoteNumber) {
+    return noteVoices[(size_t)midiChannel - 1][(size_t)midiNoteNumber];
+  }
+
+  Voice *voiceForNote(int midiChannel, int midiNoteNumber) const {
+    auto *voice = noteVoices[(size_t)midiChannel - 1][(size_t)midiNoteNumber];
+
+    if (voice != nullptr &&
+        voice->getCurrentlyPlayingNote() == midiNoteNumber &&
+        voice->isPlayingChannel(midiChannel))
+      return voice;
+
+    return nullptr;
+  }
+
+#pragma mark - Acquiring Lookup Tables
+
+  void acquireLookupTablesBank(double sampleRate) {
+    const auto waveforms = LookupTablesBank<float>::allWaveforms;
+
+    acquireBank(
+        lookupTablesHandoff, buildsLookupTablesAsynchronously,
+        [&] {
+          return lookupTablesRegistry->acquire(sampleRate, waveforms,
+                                               lookupTablesCacheFile);
+        },
+        [&](auto onReady) {
+          return lookupTablesRegistry->acquireAsync(
+              sampleRate, waveforms, lookupTablesCacheFile, std::move(onReady));
+        });
+  }
+
+  void acquireUserWavetableBank(double sampleRate, bool asynchronously) {
+    if (userWavetableFile == File()) {
+      userWavetableHandoff->reset();
+      return;
+    }
+
+    const auto cacheFile =
+        userWavetableFile.withFileExtension(wavetableCacheExtension);
+
+    acquireBank(
+        userWavetableHandoff, asynchronously,
+        [&] {
+          return lookupTablesRegistry->acquireWavetable(
+              sampleRate, userWavetableFile, cacheFile);
+        },
+        [&](auto onReady) {
+          return lookupTablesRegistry->acquireWavetableAsync(
+              sampleRate, userWavetableFile, cacheFile, std::move(onReady));
+        });
+  }
+
+  /**
+   * Acquires a bank with either of the registry's methods, and publishes it
+   * through the handoff once it's ready.
+   */
+  template <typename Acquire, typename AcquireAsync>
+  void acquireBank(const SharedLookupTablesHandoff &handoff,
+                   bool asynchronously, Acquire &&acquire,
+                   AcquireAsync &&acquireAsync) {
+    const auto generation = handoff->reset();
+
+    SharedLookupTablesBank bank;
+
+    if (asynchronously) {
+      auto onReady = [weakHandoff = std::weak_ptr(handoff),
+                      generation](SharedLookupTablesBank readyBank) {
+        if (auto lockedHandoff = weakHandoff.lock())
+          lockedHandoff->publish(std::move(readyBank), generation);
+      };
+
+      bank = acquireAsync(std::move(onReady));
+    } else {
+      bank = acquire();
+    }
+
+    if (bank != nullptr)
+      handoff->publish(std::move(bank), generation);
+  }
+
+  /** Returns the user wavetable's bank if it's ready, or the built-in one. */
+  const LookupTablesBank<float> *publishedLookupTablesBank() const {
+    if (auto *userBank = userWavetableHandoff->publishedBank.load())
+      return userBank;
+
+    return lookupTablesHandoff->publishedBank.load();
+  }
+
+  /**
+   * Picks up the tables that have been built or replaced since the last
+   * block. Called before anything else in the block reads the tables.
+   */
+  void updateVoicesLookupTablesBank() {
+    auto *publishedBank = publishedLookupTablesBank();
+
+    if (publishedBank == voicesLookupTablesBank)
+      return;
+
+    voicesLookupTablesBank = publishedBank;
+
+    for (auto &voice : voices)
+      voice->setLookupTablesBank(voicesLookupTablesBank);
+  }
+
+#pragma mark - Updating Parameters
+
+  /**
+   * Reads the parameters once per block, and lets the playing voices update
+   * what depends on the ones that changed.
+   *
+   * The synth's parameters are read once, and copied to the channels that
+   * follow them. Only the channels that have voices are updated; the others
+   * catch up when they start a note.
+   */
+  void updateParametersSnapshot() {
+    parameters.updateSnapshot(parametersSnapshot);
+    blockNumber++;
+
+    uint32_t channelsWithVoices = 0;
+
+    for (auto i = 0; i < numberOfAllocatedVoices; i++)
+      channelsWithVoices |=
+          1u << (allocatedVoices[(size_t)i]->getMidiChannel() - 1);
+
+    auto changedFields = parametersSnapshot.changedFields;
+
+    for (size_t i = 0; i < channelSnapshots.size(); i++) {
+      if ((channelsWithVoices & (1u << i)) == 0)
+        continue;
+
+      updateChannelSnapshot(i);
+      changedFields |= channelSnapshots[i].changedFields;
+    }
+
+    if (changedFields == 0)
+      return;
+
+    for (auto i = 0; i < numberOfAllocatedVoices; i++) {
+      auto *voice = allocatedVoices[(size_t)i];
+      voice->parametersDidChange(voice->getParameters().changedFields);
+    }
+  }
+
+  /**
+   * Brings the channel's snapshot up to date with its parameters. A channel
+   * that follows the synth's parameters gets a copy of the synth's snapshot,
+   * whose changes only hold if the channel followed it in the last block too.
+   */
+  void updateChannelSnapshot(size_t channel) {
+    const auto *source = channelParameters[channel].load();
+
+    auto &snapshot = channelSnapshots[channel];
+    auto &state = channelSnapshotStates[channel];
+
+    if (source != nullptr) {
+      source->updateSnapshot(snapshot);
+    } else {
+      const auto wasFollowingSynth =
+          state.source == nullptr && state.lastUpdatedBlock + 1 >= blockNumber;
+
+      snapshot = parametersSnapshot;
+
+      if (!wasFollowingSynth)
+        snapshot.changedFields = DSPParametersSnapshot::allFields;
+    }
+
+    state.source = source;
+    state.lastUpdatedBlock = blockNumber;
+  }
 
 #pragma mark - Rendering Audio Output
 
   void renderVoices(AudioBuffer<float> &outputBuffer, int startSampleIndex,
-                    int numSamples) override {
-    Synthesiser::renderVoices(outputBuffer, startSampleIndex, numSamples);
+                    int numSamples) {
+    if (rendersOnThreadPool())
+      renderVoicesOnThreadPool(outputBuffer, startSampleIndex, numSamples);
+    else
+      renderAllocatedVoices(outputBuffer, startSampleIndex, numSamples);
 
-    if (reverbIsOn())
-      applyMasterFxChain(outputBuffer, startSampleIndex, numSamples);
+    reclaimFinishedVoices();
 
-    outputBuffer.applyGainRamp(startSampleIndex, numSamples, lastMasterGain,
-                               *parameters.masterGain);
+    applyMasterSection(outputBuffer, startSampleIndex, numSamples);
+  }
 
-    lastMasterGain = *parameters.masterGain;
+  /**
+   * Renders the voices that have been allocated, which accumulate straight
+   * into the output. Idle voices aren't visited at all.
+   */
+  void renderAllocatedVoices(AudioBuffer<float> &outputBuffer,
+                             int startSampleIndex, int numSamples) {
+    for (auto i = 0; i < numberOfAllocatedVoices; i++)
+      allocatedVoices[(size_t)i]->renderNextBlock(outputBuffer,
+                                                  startSampleIndex, numSamples);
   }
 
-  void applyMasterFxChain(AudioBuffer<float> &outputBuffer,
-                          int startSampleIndex, int numSamples) {
-    auto fxBlock = tempBlock.getSubBlock(0, (size_t)numSamples);
-    fxBlock.copyFrom(outputBuffer, startSampleIndex, 0, numSamples);
+#pragma mark - Rendering on Thread Pool
+
+  bool rendersOnThreadPool() const {
+    return renderThreadPool.getNumberOfThreads() > 0 &&
+           numberOfAllocatedVoices >= multithreadingThreshold;
+  }
+
+  float *voiceSlot(int index) {
+    return voiceSlots + (size_t)index * voiceSlotStride;
+  }
+
+  /**
+   * Renders the allocated voices on the thread pool into their slots, a voice
+   * per task. The slots are then mixed on the audio thread, in the order the
+   * voices were allocated and a control block at a time, so the output is
+   * bit-identical to rendering on the audio thread alone.
+   */
+  void renderVoicesOnThreadPool(AudioBuffer<float> &outputBuffer,
+                                int startSampleIndex, int numSamples) {
+    auto renderVoice = [&](int index) {
+      voiceSlotSamples[(size_t)index].numSamples =
+          allocatedVoices[(size_t)index]->renderBlock(voiceSlot(index),
+                                                      numSamples);
+    };
 
-    auto contextToUse = dsp::ProcessContextReplacing<float>(fxBlock);
+    renderThreadPool.run(numberOfAllocatedVoices, renderVoice);
 
-    auto &reverbGain = fxChain.get<reverbGainIndex>();
-    reverbGain.setGainLinear(*parameters.reverb);
+    for (auto i = 0; i < numberOfAllocatedVoices; i++)
+      allocatedVoices[(size_t)i]->addBlockToOutput(
+          outputBuffer, startSampleIndex, voiceSlot(i),
+          voiceSlotSamples[(size_t)i].numSamples);
+  }
 
-    fxChain.process(contextToUse);
+  /** Rounds the number of samples up to a whole number of cache lines. */
+  static size_t roundedToCacheLines(size_t numSamples) {
+    return (numSamples + floatsPerCacheLine - 1) / floatsPerCacheLine *
+           floatsPerCacheLine;
+  }
 
-    outputBuffer.applyGainRamp(startSampleIndex, numSamples,
-                               1.0 - lastReverbGain, 1.0 - *parameters.reverb);
+  /**
+   * Returns the first cache line boundary in a buffer allocated with
+   * `floatsPerCacheLine` extra samples.
+   */
+  static float *alignedToCacheLine(float *buffer) {
+    return reinterpret_cast<float *>(
+        (reinterpret_cast<uintptr_t>(buffer) + cacheLineSize - 1) &
+        ~(uintptr_t)(cacheLineSize - 1));
+  }
 
-    lastReverbGain = *parameters.reverb;
+#pragma mark - Master Section
+
+  /**
+   * Crossfades the voices' mix with the reverb's output and applies the
+   * master gain, in the reverb's single mixing pass over the output.
+   */
+  void applyMasterSection(AudioBuffer<float> &outputBuffer,
+                          int startSampleIndex, int numSamples) {
+    const auto masterGain = parametersSnapshot.masterGain;
+    const auto reverbLevel = parametersSnapshot.reverb;
+
+    // The reverb keeps running for a block after it's turned off, so its
+    // level ramps down to 0.
+    if (!reverbIsOn() && lastReverbLevel == 0.0f) {
+      outputBuffer.applyGainRamp(startSampleIndex, numSamples, lastMasterGain,
+                                 masterGain);
+    } else {
+      // Turned on, the reverb ramps from the plain master gain.
+      if (lastReverbLevel == 0.0f)
+        reverb.resetOutputMix(lastMasterGain, 0.0f);
+
+      reverb.setOutputMix(masterGain * (1.0f - reverbLevel),
+                          masterGain * reverbLevel);
+
+      auto outputBlock = dsp::AudioBlock<float>(outputBuffer)
+                             .getSubBlock((size_t)startSampleIndex,
+                                          (size_t)numSamples);
+      reverb.process(dsp::ProcessContextReplacing<float>(outputBlock));
+    }
 
-    juce::dsp::AudioBlock<float>(outputBuffer)
-        .getSubBlock((size_t)startSampleIndex, (size_t)numSamples)
-        .add(tempBlock);
+    lastMasterGain = masterGain;
+    lastReverbLevel = reverbLevel;
   }
 };
@@ -11,76 +11,572 @@
 #pragma once
 
 #include <cmath>
-#include <thread>
+#include <cstdint>
+#include <type_traits>
 
 #include "LookupTablesBank.h"
 
+/**
+ * Band-limited table lookup oscillator followed by a VCA.
+ *
+ * The whole block is rendered in one pass: the phase is a 32-bit fixed-point
+ * accumulator that wraps by overflow, the table octaves are resolved only when
+ * the frequency or the waveform changes, and the VCA gain ramp is applied in
+ * the same loop.
+ *
+ * Like `dsp::Oscillator` followed by `dsp::Gain`, the oscillator's output is
+ * added to the block's contents, and the sum is then scaled by the gain.
+ *
+ * The waveform can be morphed continuously: two adjacent waveforms are read
+ * in the same pass and blended per sample. Their tables are adjacent channels
+ * of the bank's interleaved table, except for the static sine.
+ * With a user wavetable bank, the same position sweeps through its frames.
+ *
+ * Saw and square can alternatively be rendered analytically, with PolyBLEP
+ * residuals smoothing their discontinuities, which needs no tables at all.
+ * This engine is also used while no lookup tables bank is set, e.g. until the
+ * tables are built. Two PolyBLEP oscillators can be rendered in the same
+ * pass with `processPair()`.
+ */
 template <typename ValueType> class VCAOscillator {
 public:
-  using Oscillator = dsp::Oscillator<ValueType>;
-  using LookupTablesBank = LookupTablesBank<ValueType>;
+  using LookupTablesBank = ::LookupTablesBank<ValueType>;
+  using LookupTable = typename LookupTablesBank::LookupTable;
   using Waveform = typename LookupTablesBank::Waveform;
 
+  enum Engine { Wavetable, PolyBLEP, NumberOfEngines };
+
   VCAOscillator() noexcept = default;
 
 #pragma mark - Initialization
 
-  void initialize(const LookupTablesBank &lookupTable) {
-    oscillator().initialise([this, &lookupTable](ValueType phase) {
-      return lookupTable(phase, currentWaveform, oscillator().getFrequency());
-    });
+  /** Sets the tables to render from, or nullptr to use PolyBLEP waveforms. */
+  void initialize(const LookupTablesBank *lookupTable) {
+    lookupTablesBank = lookupTable;
+    updateOctaveTables();
   }
 
 #pragma mark - Preparing for Operation
 
   void prepare(const dsp::ProcessSpec &spec) {
-    processorChain.prepare(spec);
     sampleRate = spec.sampleRate;
+
+    updateFrequency();
+
+    updateRampLength();
+    reset();
   }
 
 #pragma mark - Setting Properties
 
-  void setWaveform(Waveform waveform) { currentWaveform = waveform; }
+  void setEngine(Engine newEngine) { engine = newEngine; }
+
+  void setWaveform(Waveform waveform) {
+    setWaveformPosition(static_cast<ValueType>(waveform));
+  }
+
+  /**
+   * Sets the morph position between waveforms, from 0 (sine) to
+   * `NumberOfWaveForms - 1` (square). Fractional positions blend the two
+   * adjacent waveforms.
+   */
+  void setWaveformPosition(ValueType position) {
+    waveformPosition = jlimit(ValueType(0), ValueType(lastWaveform), position);
+
+    const auto lowerWaveform =
+        jmin(static_cast<int>(waveformPosition), lastWaveform - 1);
+
+    currentWaveform = static_cast<Waveform>(lowerWaveform);
+    waveformMorph = waveformPosition - lowerWaveform;
+
+    updateOctaveTables();
+  }
 
   void setFrequency(ValueType newValue) {
     const auto nyquistFrequency = 0.5 * sampleRate;
     if (newValue > nyquistFrequency)
       newValue = nyquistFrequency;
 
-    oscillator().setFrequency(newValue, true);
+    if (newValue == frequency)
+      return;
+
+    frequency = newValue;
+    updateFrequency();
   }
 
-  void setLevel(ValueType newValue) { gainProcessor().setGainLinear(newValue); }
+  void setLevel(ValueType newValue) {
+    if (newValue == targetGain)
+      return;
+
+    targetGain = newValue;
+
+    if (rampLength <= 0) {
+      gain = targetGain;
+      return;
+    }
+
+    rampSamplesRemaining = rampLength;
+    gainStep = (targetGain - gain) / rampLength;
+  }
 
   void setRampDurationSeconds(double duration) {
-    gainProcessor().setRampDurationSeconds(duration);
+    rampDurationSeconds = duration;
+    updateRampLength();
   }
 
 #pragma mark - Resetting Processing
 
-  void reset() noexcept { processorChain.reset(); }
+  void reset() noexcept {
+    phase = initialPhase;
+    gain = targetGain;
+    rampSamplesRemaining = 0;
+  }
 
 #pragma mark - Processing Audio Context
 
   template <typename ProcessContext>
   void process(const ProcessContext &context) noexcept {
-    processorChain.process(context);
+    if (context.isBypassed)
+      return;
+
+    auto &&block = context.getOutputBlock();
+    auto state = renderState();
+
+    for (size_t channel = 0; channel < block.getNumChannels(); channel++) {
+      state = renderState();
+      render(block.getChannelPointer(channel), block.getNumSamples(), state);
+    }
+
+    setRenderState(state);
+  }
+
+  /**
+   * Processes the context with `first` and then `second`, with the same
+   * arithmetic as calling their `process()` one after the other. When both
+   * render PolyBLEP waveforms into one channel, they're rendered in the same
+   * loop, so that the two oscillators' independent phases and residuals are
+   * computed side by side, rather than in two passes over the block.
+   */
+  template <typename ProcessContext>
+  static void processPair(VCAOscillator &first, VCAOscillator &second,
+                          const ProcessContext &context) noexcept {
+    auto &&block = context.getOutputBlock();
+
+    if (context.isBypassed || block.getNumChannels() != 1 ||
+        !first.rendersPolyBLEP() || !second.rendersPolyBLEP()) {
+      first.process(context);
+      second.process(context);
+      return;
+    }
+
+    auto firstState = first.renderState();
+    auto secondState = second.renderState();
+
+    first.withPolyBLEPGenerator([&](auto &&firstGenerator) {
+      second.withPolyBLEPGenerator([&](auto &&secondGenerator) {
+        renderPairSegments(first, second, block.getChannelPointer(0),
+                           block.getNumSamples(), firstState, secondState,
+                           firstGenerator, secondGenerator);
+      });
+    });
+
+    first.setRenderState(firstState);
+    second.setRenderState(secondState);
   }
 
 private:
-  enum { oscIndex, gainIndex };
+  static constexpr auto phaseRange = 4294967296.0;
+  static constexpr auto fractionBits =
+      32 - LookupTablesBank::tableResolutionOrder;
+  static constexpr uint32_t fractionMask = (1u << fractionBits) - 1;
+  static constexpr auto fractionScale = ValueType(1) / (1u << fractionBits);
+  static constexpr auto phaseScale = static_cast<ValueType>(1 / phaseRange);
+
+  static constexpr auto lastWaveform = LookupTablesBank::NumberOfWaveForms - 1;
+
+  /** Matches the zero phase of `dsp::Oscillator`, which starts at -pi. */
+  static constexpr uint32_t initialPhase = 1u << 31;
+
+  struct RenderState {
+    uint32_t phase;
+    ValueType gain;
+    int rampSamplesRemaining;
+  };
+
+  /** The tables of one of the morphed waveforms, for two octaves. */
+  struct MorphSource {
+    const ValueType *table = nullptr;
+    const ValueType *nextTable = nullptr;
+    uint32_t stride = 1;
 
+    ValueType sample(uint32_t index, ValueType fraction,
+                     ValueType crossfade) const noexcept {
+      const auto position = index * stride;
+
+      const auto value = interpolate(table, position, stride, fraction);
+      const auto nextValue = interpolate(nextTable, position, stride, fraction);
+
+      return value + crossfade * (nextValue - value);
+    }
+  };
+
+  const LookupTablesBank *lookupTablesBank = nullptr;
+
+  ValueType waveformPosition = 0;
+
+  /** The lower of the two morphed waveforms, for the PolyBLEP engine. */
   Waveform currentWaveform{};
+  ValueType waveformMorph = 0;
+  Engine engine = Wavetable;
 
   double sampleRate = 0;
+  ValueType frequency = 0;
+
+  uint32_t phase = initialPhase;
+  uint32_t phaseIncrement = 0;
+
+  MorphSource lowerSource;
+  MorphSource upperSource;
+  ValueType octaveCrossfade = 0;
+  ValueType tableMorph = 0;
+
+  double rampDurationSeconds = 0;
+  int rampLength = 0;
+  int rampSamplesRemaining = 0;
+
+  ValueType gain = 0;
+  ValueType targetGain = 0;
+  ValueType gainStep = 0;
+
+#pragma mark - Updating State
+
+  /**
+   * Resolves everything that depends on the frequency, so that the render
+   * loop never has to.
+   */
+  void updateFrequency() {
+    phaseIncrement = static_cast<uint32_t>(frequency / sampleRate * phaseRange);
+
+    updateOctaveTables();
+  }
+
+  void updateOctaveTables() {
+    if (lookupTablesBank == nullptr) {
+      lowerSource = upperSource = MorphSource();
+      return;
+    }
+
+    int octave;
+    LookupTable::octaveForFrequency(frequency, octave, octaveCrossfade);
+
+    const auto nextOctave = jmin(octave + 1, LookupTable::numberOfOctaves - 1);
 
-  dsp::ProcessorChain<Oscillator, dsp::Gain<ValueType>> processorChain;
+    if (lookupTablesBank->waveforms() != 0) {
+      lowerSource = waveformSource(currentWaveform, octave, nextOctave);
+      upperSource = waveformSource(static_cast<Waveform>(currentWaveform + 1),
+                                   octave, nextOctave);
+      tableMorph = waveformMorph;
 
-#pragma mark - Accessing Processors
+      return;
+    }
+
+    // The morph position spans all frames of a user wavetable.
+    const auto &table = lookupTablesBank->getTable();
+    const auto stride = table.getNumChannels();
+
+    const auto channelPosition = waveformPosition * (stride - 1) / lastWaveform;
+    const auto channel =
+        jmin(static_cast<int>(channelPosition), jmax(stride - 2, 0));
+    const auto upperChannel = jmin(channel + 1, stride - 1);
+
+    lowerSource = {table.octaveTable(octave) + channel,
+                   table.octaveTable(nextOctave) + channel, (uint32_t)stride};
+    upperSource = {table.octaveTable(octave) + upperChannel,
+                   table.octaveTable(nextOctave) + upperChannel,
+                   (uint32_t)stride};
+    tableMorph = channelPosition - channel;
+  }
+
+  MorphSource waveformSource(Waveform waveform, int octave,
+                             int nextOctave) const {
+    return {lookupTablesBank->waveformTable(waveform, octave),
+            lookupTablesBank->waveformTable(waveform, nextOctave),
+            (uint32_t)lookupTablesBank->waveformTableStride(waveform)};
+  }
+
+  void updateRampLength() {
+    rampLength = static_cast<int>(std::floor(rampDurationSeconds * sampleRate));
+
+    gain = targetGain;
+    rampSamplesRemaining = 0;
+  }
+
+#pragma mark - Rendering
+
+  RenderState renderState() const noexcept {
+    return {phase, gain, rampSamplesRemaining};
+  }
+
+  void setRenderState(const RenderState &state) noexcept {
+    phase = state.phase;
+    gain = state.gain;
+    rampSamplesRemaining = state.rampSamplesRemaining;
+  }
+
+  bool rendersPolyBLEP() const noexcept {
+    return engine == PolyBLEP || lowerSource.table == nullptr;
+  }
 
-  Oscillator &oscillator() { return processorChain.template get<oscIndex>(); }
+  void render(ValueType *output, size_t numSamples,
+              RenderState &state) const noexcept {
+    if (rendersPolyBLEP()) {
+      renderPolyBLEP(output, numSamples, state);
+      return;
+    }
+
+    const auto lower = lowerSource;
+    const auto upper = upperSource;
+    const auto crossfade = octaveCrossfade;
+    const auto morph = tableMorph;
+
+    renderSegments(output, numSamples, state, [=](uint32_t currentPhase) {
+      const auto index = currentPhase >> fractionBits;
+      const auto fraction =
+          static_cast<ValueType>(currentPhase & fractionMask) * fractionScale;
+
+      const auto sample = lower.sample(index, fraction, crossfade);
+      const auto morphedSample = upper.sample(index, fraction, crossfade);
+
+      return sample + morph * (morphedSample - sample);
+    });
+  }
+
+  /**
+   * Renders waveforms analytically, scaled like the band-limited tables, i.e.
+   * like the sums of their Fourier series.
+   */
+  void renderPolyBLEP(ValueType *output, size_t numSamples,
+                      RenderState &state) const noexcept {
+    withPolyBLEPGenerator([&](auto &&generator) {
+      renderSegments(output, numSamples, state, generator);
+    });
+  }
+
+  /**
+   * Calls `callback` with the generator of the current PolyBLEP waveform,
+   * which returns the sample at a phase.
+   */
+  template <typename Callback>
+  void withPolyBLEPGenerator(Callback &&callback) const noexcept {
+    const auto phaseDelta = static_cast<ValueType>(phaseIncrement) * phaseScale;
+    const auto morph = waveformMorph;
+
+    switch (currentWaveform) {
+    case LookupTablesBank::Saw:
+      callback([=](uint32_t currentPhase) {
+        const auto sample = polyBLEPSaw(currentPhase, phaseDelta);
+
+        return sample +
+               morph * (polyBLEPSquare(currentPhase, phaseDelta) - sample);
+      });
+      break;
+    default:
+      callback([=](uint32_t currentPhase) {
+        const auto sample = phaseSine(currentPhase);
+
+        return sample +
+               morph * (polyBLEPSaw(currentPhase, phaseDelta) - sample);
+      });
+      break;
+    }
+  }
+
+  static ValueType polyBLEPSaw(uint32_t phase, ValueType phaseDelta) noexcept {
+    constexpr auto pi = MathConstants<ValueType>::pi;
+
+    const auto t = static_cast<ValueType>(phase) * phaseScale;
+
+    return ValueType(0.5) * pi * (1 - 2 * t + polyBLEP(t, phaseDelta));
+  }
+
+  static ValueType polyBLEPSquare(uint32_t phase,
+                                  ValueType phaseDelta) noexcept {
+    constexpr auto pi = MathConstants<ValueType>::pi;
+
+    const auto halfPhase = static_cast<uint32_t>(phase + (1u << 31));
+    const auto t = static_cast<ValueType>(phase) * phaseScale;
+    const auto halfT = static_cast<ValueType>(halfPhase) * phaseScale;
+
+    const auto naive = phase < (1u << 31) ? 1 : -1;
+
+    return ValueType(0.25) * pi *
+           (naive + polyBLEP(t, phaseDelta) - polyBLEP(halfT, phaseDelta));
+  }
+
+  static ValueType phaseSine(uint32_t phase) noexcept {
+    return sine(static_cast<int32_t>(phase) * ValueType(2) * phaseScale);
+  }
+
+  /**
+   * Polynomial approximation of the band-limited step residual, for a
+   * discontinuity of height 2 at t = 0.
+   */
+  static ValueType polyBLEP(ValueType t, ValueType dt) noexcept {
+    if (t < dt) {
+      t /= dt;
+      return t + t - t * t - 1;
+    }
+
+    if (t > 1 - dt) {
+      t = (t - 1) / dt;
+      return t * t + t + t + 1;
+    }
+
+    return 0;
+  }
+
+  /** Approximates sin(pi * x) for x in [-1, 1), within 0.001. */
+  static ValueType sine(ValueType x) noexcept {
+    const auto y = 4 * x * (1 - std::abs(x));
+
+    return y + ValueType(0.225) * (y * std::abs(y) - y);
+  }
+
+  template <typename Generator>
+  void renderSegments(ValueType *output, size_t numSamples, RenderState &state,
+                      Generator &&generator) const noexcept {
+    const auto numRampSamples =
+        jmin(numSamples, static_cast<size_t>(state.rampSamplesRemaining));
+
+    renderSegment<true>(output, numRampSamples, state, generator);
+    renderSegment<false>(output + numRampSamples, numSamples - numRampSamples,
+                         state, generator);
+  }
+
+  template <bool isRamping, typename Generator>
+  void renderSegment(ValueType *output, size_t numSamples, RenderState &state,
+                     Generator &generator) const noexcept {
+    if (numSamples == 0)
+      return;
+
+    const auto increment = phaseIncrement;
+    const auto step = gainStep;
+
+    auto currentPhase = state.phase;
+    auto currentGain = isRamping ? state.gain : targetGain;
+
+    for (size_t i = 0; i < numSamples; i++) {
+      const auto sample = generator(currentPhase);
+
+      if constexpr (isRamping)
+        currentGain += step;
+
+      output[i] = (output[i] + sample) * currentGain;
+      currentPhase += increment;
+    }
+
+    endSegment<isRamping>(state, currentPhase, currentGain, numSamples);
+  }
+
+  template <bool isRamping>
+  void endSegment(RenderState &state, uint32_t currentPhase,
+                  ValueType currentGain, size_t numSamples) const noexcept {
+    state.phase = currentPhase;
+
+    if constexpr (isRamping) {
+      state.rampSamplesRemaining -= static_cast<int>(numSamples);
+      state.gain = state.rampSamplesRemaining > 0 ? currentGain : targetGain;
+    }
+  }
+
+  /**
+   * Splits the block where either oscillator's gain ramp ends, like
+   * `renderSegments()` does for one.
+   */
+  template <typename FirstGenerator, typename SecondGenerator>
+  static void renderPairSegments(const VCAOscillator &first,
+                                 const VCAOscillator &second,
+                                 ValueType *output, size_t numSamples,
+                                 RenderState &firstState,
+                                 RenderState &secondState,
+                                 FirstGenerator &firstGenerator,
+                                 SecondGenerator &secondGenerator) noexcept {
+    const auto firstRampSamples = jmin(
+        numSamples, static_cast<size_t>(firstState.rampSamplesRemaining));
+    const auto secondRampSamples = jmin(
+        numSamples, static_cast<size_t>(secondState.rampSamplesRemaining));
+
+    const auto bothRamp = jmin(firstRampSamples, secondRampSamples);
+    const auto eitherRamps = jmax(firstRampSamples, secondRampSamples);
+
+    auto renderBetween = [&](auto firstIsRamping, auto secondIsRamping,
+                             size_t start, size_t end) {
+      renderPairSegment<decltype(firstIsRamping)::value,
+                        decltype(secondIsRamping)::value>(
+          first, second, output + start, end - start, firstState, secondState,
+          firstGenerator, secondGenerator);
+    };
+
+    renderBetween(std::true_type{}, std::true_type{}, 0, bothRamp);
+
+    if (firstRampSamples > secondRampSamples)
+      renderBetween(std::true_type{}, std::false_type{}, bothRamp, eitherRamps);
+    else
+      renderBetween(std::false_type{}, std::true_type{}, bothRamp, eitherRamps);
+
+    renderBetween(std::false_type{}, std::false_type{}, eitherRamps,
+                  numSamples);
+  }
+
+  template <bool firstIsRamping, bool secondIsRamping, typename FirstGenerator,
+            typename SecondGenerator>
+  static void renderPairSegment(const VCAOscillator &first,
+                                const VCAOscillator &second,
+                                ValueType *output, size_t numSamples,
+                                RenderState &firstState,
+                                RenderState &secondState,
+                                FirstGenerator &firstGenerator,
+                                SecondGenerator &secondGenerator) noexcept {
+    if (numSamples == 0)
+      return;
+
+    const auto firstIncrement = first.phaseIncrement;
+    const auto secondIncrement = second.phaseIncrement;
+    const auto firstStep = first.gainStep;
+    const auto secondStep = second.gainStep;
+
+    auto firstPhase = firstState.phase;
+    auto secondPhase = secondState.phase;
+    auto firstGain = firstIsRamping ? firstState.gain : first.targetGain;
+    auto secondGain = secondIsRamping ? secondState.gain : second.targetGain;
+
+    for (size_t i = 0; i < numSamples; i++) {
+      const auto firstSample = firstGenerator(firstPhase);
+      const auto secondSample = secondGenerator(secondPhase);
+
+      if constexpr (firstIsRamping)
+        firstGain += firstStep;
+
+      if constexpr (secondIsRamping)
+        secondGain += secondStep;
+
+      // Two statements, so the first product is rounded like in `process()`.
+      const auto firstOutput = (output[i] + firstSample) * firstGain;
+      output[i] = (firstOutput + secondSample) * secondGain;
+
+      firstPhase += firstIncrement;
+      secondPhase += secondIncrement;
+    }
+
+    first.template endSegment<firstIsRamping>(firstState, firstPhase,
+                                              firstGain, numSamples);
+    second.template endSegment<secondIsRamping>(secondState, secondPhase,
+                                                secondGain, numSamples);
+  }
 
-  dsp::Gain<ValueType> &gainProcessor() {
-    return processorChain.template get<gainIndex>();
+  static ValueType interpolate(const ValueType *table, uint32_t position,
+                               uint32_t stride, ValueType fraction) noexcept {
+    return table[position] +
+           fraction * (table[position + stride] - table[position]);
   }
 };
@@ -10,7 +10,12 @@
 
 #pragma once
 
+#include <array>
+#include <vector>
+
 #include "DSPParameters.h"
+#include "Envelope.h"
+#include "LadderFilter.h"
 #include "LookupTablesBank.h"
 #include "VCAOscillator.h"
 #include <juce_audio_basics/juce_audio_basics.h>
@@ -18,23 +23,21 @@
 
 // class LookupTablesBank;
 
-#pragma mark - Sound Class
-
-class Sound : public SynthesiserSound {
-public:
-  bool appliesToNote(int /* midiNoteNumber */) override { return true; }
-
-  bool appliesToChannel(int /* channelNumber */) override { return true; }
-};
-
 #pragma mark - Voice Class
 
-class Voice : public SynthesiserVoice, private Timer {
+/**
+ * A single voice of the synth. Voices are owned and driven by `Synth`, which
+ * calls them directly rather than through virtual functions.
+ */
+class Voice {
 public:
 #pragma mark - Static Settings
 
   static constexpr auto gainHeadroom = 0.9f;
 
+  /** Applied as the voice is mixed into the output. */
+  static constexpr auto outputGain = 1.0f - gainHeadroom;
+
   static constexpr auto minCutoff = 50.0f;
   static constexpr auto maxCutoff = 22000.0f;
 
@@ -46,6 +49,23 @@ public:
   static constexpr auto maxDetuningFactor = 6.0;
   static constexpr auto maxAnalogFactor = 0.0025f;
 
+  /** The longest the filter may ring after the envelope has finished. */
+  static constexpr auto maxTailDurationSeconds = 1.0;
+
+  /**
+   * The voice is released once its filter output is quieter than this, which
+   * is -100 dB after the output gain.
+   */
+  static constexpr auto silenceThreshold = 1.0e-5f / outputGain;
+
+  /**
+   * The rate of control updates, i.e. of the LFO and the filter targets,
+   * which is independent of the sample rate. The filter's coefficients are
+   * ramped per sample between updates, and the envelope is rendered at audio
+   * rate.
+   */
+  static constexpr auto defaultControlRateHz = 1000.0;
+
 #pragma mark - Default Properties Values
 
   static constexpr auto defaultCutoff = maxCutoff;
@@ -62,100 +82,265 @@ public:
 
   static constexpr auto defaultDetuningFactor = 2.0;
 
+  static constexpr auto defaultStereoSpread = 0.0f;
+
 #pragma mark - Type Aliases
 
-  using Waveform = VCAOscillator<float>::Waveform;
+  using OscillatorEngine = VCAOscillator<float>::Engine;
+  using Parameters = DSPParametersSnapshot;
 
 #pragma mark - Construction
 
-  explicit Voice(DSPParameters &parameters) : parameters(parameters) {
-    filter().setCutoffFrequencyHz(*parameters.cutoff);
-    filter().setResonance(*parameters.resonance);
+  /**
+   * `parameters` are updated by the synth, once per block. The voice's
+   * analog drift is seeded with `voiceIndex`, so renders are repeatable.
+   */
+  explicit Voice(const Parameters &parameters, int voiceIndex = 0)
+      : parameters(&parameters), randomSeed(voiceIndex) {
+    setFilterParameters(parameters.cutoff, parameters.resonance);
+
+    // The same static table is shared by all voices and instances.
+    lfo.initialise([](float x) {
+      return sineTable<float, LookupTablesBank<float>::tableResolutionOrder>(x);
+    });
   }
 
 #pragma mark - Preparing Voice For Operation
 
+  /**
+   * `scratchBlock` is shared by all voices, which render into it one at a
+   * time and accumulate it into the output.
+   *
+   * Voices are rendered in mono, whatever the number of output channels, and
+   * are placed in the stereo field as they're mixed into the output.
+   *
+   * `controlBlockSize` is the number of samples between control updates.
+   */
   void prepare(const dsp::ProcessSpec &spec,
-               const LookupTablesBank<float> &lookupTable) noexcept {
-    setCurrentPlaybackSampleRate(spec.sampleRate);
-
-    tempBlock = dsp::AudioBlock<float>(heapBlock, spec.numChannels,
-                                       spec.maximumBlockSize);
+               const LookupTablesBank<float> *lookupTable,
+               const dsp::AudioBlock<float> &scratchBlock,
+               size_t controlBlockSize) noexcept {
+    this->scratchBlock = scratchBlock.getSingleChannelBlock(0);
+    this->controlBlockSize = jmax((size_t)1, controlBlockSize);
+    envelopeBuffer.assign(this->controlBlockSize, 0);
 
     // Initialize Oscillators
 
-    firstOscillator().initialize(lookupTable);
-    secondOscillator().initialize(lookupTable);
+    setLookupTablesBank(lookupTable);
 
-    processorChain.prepare(spec);
+    processorChain.prepare({spec.sampleRate, spec.maximumBlockSize, 1});
 
     // Initialize LFO & VCAs Ramps
 
-    auto lfoSampleRate = spec.sampleRate / lfoSubBlockSize;
-    auto lfoSampleDuration = 1 / lfoSampleRate;
+    auto controlRate = spec.sampleRate / (double)this->controlBlockSize;
+    auto controlPeriod = 1 / controlRate;
+
+    envelope.setSampleRate(spec.sampleRate);
+    envelope.reset();
 
-    adsr.setSampleRate(lfoSampleRate);
+    firstOscillator().setRampDurationSeconds(controlPeriod);
+    secondOscillator().setRampDurationSeconds(controlPeriod);
 
-    firstOscillator().setRampDurationSeconds(lfoSampleDuration);
-    secondOscillator().setRampDurationSeconds(lfoSampleDuration);
+    lfo.prepare({controlRate, spec.maximumBlockSize, spec.numChannels});
 
-    gainProcessor().setGainLinear(1.0 - gainHeadroom);
+    maxTailSamples = (int)(maxTailDurationSeconds * spec.sampleRate);
 
-    lfo.initialise([](float x) { return std::sin(x); }, 1024);
-    lfo.prepare({lfoSampleRate, spec.maximumBlockSize, spec.numChannels});
+    // Every prepare starts the same drift, e.g. for every offline render.
+    random.setSeed(randomSeed);
 
+    noteIsPlaying = false;
     clearCurrentNote();
   }
 
-#pragma mark - Juce SynthesiserVoice Methods Overrides
+#pragma mark - Setting Lookup Tables
+
+  /** Sets the oscillators' tables, or nullptr to use the fallback waveforms. */
+  void setLookupTablesBank(const LookupTablesBank<float> *lookupTable) {
+    firstOscillator().initialize(lookupTable);
+    secondOscillator().initialize(lookupTable);
+  }
+
+#pragma mark - Setting Filter Cutoff Table
 
-  bool canPlaySound(SynthesiserSound *sound) override {
-    return dynamic_cast<Sound *>(sound) != nullptr;
+  /**
+   * Sets the table that the filter maps cutoffs with, which is shared by all
+   * voices. Must be called before `prepare()`.
+   */
+  void setFilterCutoffTable(const LadderFilterCutoffTable *table) {
+    filter().setCutoffTable(table);
   }
 
-  void startNote(int midiNoteNumber, float velocity, SynthesiserSound *,
-                 int currentPitchWheelPosition) override {
-    currentNoteFrequency = getBendedFrequencyForWheel(
-        currentPitchWheelPosition, getCurrentlyPlayingNote());
+#pragma mark - Stereo Placement
+
+  /**
+   * Sets the side of the stereo field the next note is placed on, from -1
+   * (left) to 1 (right). The note is panned by that much of the spread.
+   */
+  void setStereoSide(float side) { stereoSide = side; }
+
+  /**
+   * Adds the voice's mono output into the output buffer with the output gain,
+   * panned with a balance law, which leaves centred voices at unity gain.
+   */
+  void addToOutput(AudioSampleBuffer &outputBuffer, int startSampleIndex,
+                   const float *samples, int numSamples) {
+    const auto numChannels = outputBuffer.getNumChannels();
+
+    if (numChannels != 2) {
+      for (auto channel = 0; channel < numChannels; channel++)
+        outputBuffer.addFrom(channel, startSampleIndex, samples, numSamples,
+                             outputGain);
+      return;
+    }
 
-    updateFilterDrive();
-    updateOscillatorsFrequency();
+    const auto channelGains = stereoChannelGains();
 
-    lfo.setFrequency(currentNoteFrequency / std::pow(2, 5));
+    for (auto channel = 0; channel < 2; channel++) {
+      outputBuffer.addFromWithRamp(channel, startSampleIndex, samples,
+                                   numSamples, lastChannelGains[channel],
+                                   channelGains[channel]);
+    }
+
+    lastChannelGains = channelGains;
+  }
+
+  /** The gains of the left and right channels, including the output gain. */
+  std::array<float, 2> stereoChannelGains() const {
+    const auto pan = stereoSide * parameters->stereoSpread;
+
+    return {outputGain * jmin(1.0f, 1.0f - pan),
+            outputGain * jmin(1.0f, 1.0f + pan)};
+  }
+
+#pragma mark - Updating Parameters
+
+  /**
+   * Binds the voice to another parameters snapshot, e.g. the one of a
+   * multi-timbral channel. The voice must be idle, and catches up with the
+   * parameters when it starts its next note.
+   */
+  void setParameters(const Parameters &newParameters) {
+    jassert(!isVoiceActive());
+    parameters = &newParameters;
+  }
+
+  const Parameters &getParameters() const { return *parameters; }
+
+  /** Updates the state that depends on the parameters that changed. */
+  void parametersDidChange(Parameters::FieldSet changedFields) {
+    const auto changed = [&](auto... fields) {
+      return (changedFields & (Parameters::fieldSet(fields) | ...)) != 0;
+    };
+
+    if (changed(Parameters::OscillatorWaveform))
+      updateOscillatorsWaveform();
+
+    if (changed(Parameters::OscillatorEngine))
+      updateOscillatorsEngine();
+
+    if (changed(Parameters::DetuningAmount))
+      updateOscillatorsFrequency();
+
+    if (changed(Parameters::FilterDrive))
+      updateFilterDrive();
+
+    if (changed(Parameters::Attack, Parameters::Decay, Parameters::Sustain,
+                Parameters::Release))
+      updateEnvelopeParameters();
+
+    if (changed(Parameters::Cutoff, Parameters::Resonance,
+                Parameters::CutoffEnvelopeAmount,
+                Parameters::ResonanceEnvelopeAmount))
+      updateFilterEnvelope();
+
+    if (changed(Parameters::VelocityEnvelopeAmount))
+      updateVelocityLevel();
+  }
+
+#pragma mark - Getting State
+
+  /** The envelope's level at the last control update, for voice stealing. */
+  float getEnvelopeLevel() const { return currentEnvelopeLevel; }
+
+#pragma mark - Note State
+
+  /** Returns the note the voice is playing, or -1 if it's idle. */
+  int getCurrentlyPlayingNote() const { return currentlyPlayingNote; }
+
+  bool isPlayingChannel(int midiChannel) const {
+    return currentMidiChannel == midiChannel;
+  }
+
+  /** The MIDI channel of the voice's last note. */
+  int getMidiChannel() const { return currentMidiChannel; }
+
+  /** A voice is active from its note-on until its tail has faded out. */
+  bool isVoiceActive() const { return currentlyPlayingNote >= 0; }
+
+  bool wasStartedBefore(const Voice &other) const {
+    return noteOnTime < other.noteOnTime;
+  }
+
+  bool isKeyDown() const { return keyIsDown; }
+  void setKeyDown(bool isDown) { keyIsDown = isDown; }
+
+  bool isSustainPedalDown() const { return sustainPedalIsDown; }
+  void setSustainPedalDown(bool isDown) { sustainPedalIsDown = isDown; }
+
+  bool isSostenutoPedalDown() const { return sostenutoPedalIsDown; }
+  void setSostenutoPedalDown(bool isDown) { sostenutoPedalIsDown = isDown; }
+
+#pragma mark - Playing Notes
+
+  /**
+   * Starts the note with its key down. The voice must be idle, and
+   * `noteOnTime` must increase with every note, for voice stealing.
+   */
+  void startNote(int midiChannel, int midiNoteNumber, float velocity,
+                 int currentPitchWheelPosition, uint32_t noteOnTime) {
+    currentlyPlayingNote = midiNoteNumber;
+    currentMidiChannel = midiChannel;
+    this->noteOnTime = noteOnTime;
+    keyIsDown = true;
+
+    currentNoteFrequency = getBendedFrequencyForWheel(
+        currentPitchWheelPosition, getCurrentlyPlayingNote());
 
     currentVelocity =
-        1.0f - (*parameters.velocityEnvelopeAmount) * (1.0f - velocity);
+        1.0f - parameters->velocityEnvelopeAmount * (1.0f - velocity);
 
-    firstOscillator().setLevel(currentVelocity);
-    secondOscillator().setLevel(currentVelocity);
+    // Idle voices don't follow the parameters, so catch up with all of them.
+    parametersDidChange(Parameters::allFields);
+
+    lfo.setFrequency(currentNoteFrequency / std::pow(2, 5));
 
     if (modulationAmount > 0.0f) {
       updateModulation();
     }
 
-    updateADSRParameters();
-
     noteWillStartAttack();
-    adsr.noteOn();
+    envelope.noteOn();
   }
 
-  void stopNote(float /* velocity */, bool allowTailOff) override {
+  void stopNote(float /* velocity */, bool allowTailOff) {
     if (allowTailOff) {
-      adsr.noteOff();
+      envelope.noteOff();
     } else {
+      envelope.reset();
       noteDidFade();
-      adsr.reset();
+
+      currentEnvelopeLevel = 0.0f;
     }
   }
 
-  void pitchWheelMoved(int newPitchWheelValue) override {
+  void pitchWheelMoved(int newPitchWheelValue) {
     currentNoteFrequency = getBendedFrequencyForWheel(
         newPitchWheelValue, getCurrentlyPlayingNote());
 
     updateOscillatorsFrequency();
   }
 
-  void controllerMoved(int controllerNumber, int newControllerValue) override {
+  void controllerMoved(int controllerNumber, int newControllerValue) {
     if (controllerNumber == 1) {
       auto percentage = (float)newControllerValue / 127;
       modulationAmount = percentage;
@@ -164,70 +349,133 @@ public:
 
 #pragma mark - Rendering Audio Output
 
+  /**
+   * Renders the block into the shared scratch block, and adds it into the
+   * output with the output gain. Idle voices return right away.
+   */
   void renderNextBlock(AudioSampleBuffer &outputBuffer, int startSampleIndex,
-                       int numSamples) override {
-    auto output = tempBlock.getSubBlock(0, (size_t)numSamples);
-    output.clear();
+                       int numSamples) {
+    auto *samples = scratchBlock.getChannelPointer(0);
+    const auto renderedSamples = renderBlock(samples, numSamples);
+
+    addBlockToOutput(outputBuffer, startSampleIndex, samples, renderedSamples);
+  }
+
+  /**
+   * Renders the voice's mono output into `samples` without mixing it, which
+   * doesn't touch any state shared with other voices. Returns the number of
+   * samples rendered before the voice went silent, which may be zero.
+   */
+  int renderBlock(float *samples, int numSamples) {
+    auto position = 0;
 
-    if (noteIsPlaying) {
-      for (size_t subBlockPosition = 0;
-           subBlockPosition < (size_t)numSamples;) {
-        auto subBlockSize =
-            jmin(lfoSubBlockSize, (size_t)numSamples - subBlockPosition);
-        auto subBlock = output.getSubBlock(subBlockPosition, subBlockSize);
+    while (noteIsPlaying && position < numSamples) {
+      auto subBlockSize = jmin((int)controlBlockSize, numSamples - position);
 
-        renderLFOSubBlock(subBlock);
+      float *channels[] = {samples + position};
+      auto subBlock = dsp::AudioBlock<float>(channels, 1, (size_t)subBlockSize);
+      subBlock.clear();
 
-        subBlockPosition += subBlockSize;
-      }
+      renderControlBlock(subBlock);
 
-      if (!adsr.isActive() && !isTimerRunning()) {
-        noteDidFade();
-      }
+      updateNoteLifecycle(samples + position, (size_t)subBlockSize);
+
+      position += subBlockSize;
     }
 
-    dsp::AudioBlock<float>(outputBuffer)
-        .getSubBlock(startSampleIndex, numSamples)
-        .add(tempBlock);
+    return position;
+  }
+
+  /**
+   * Adds samples rendered by `renderBlock()` into the output a control block
+   * at a time, exactly like `renderNextBlock()` does.
+   */
+  void addBlockToOutput(AudioSampleBuffer &outputBuffer, int startSampleIndex,
+                        const float *samples, int numSamples) {
+    for (auto position = 0; position < numSamples;) {
+      auto subBlockSize = jmin((int)controlBlockSize, numSamples - position);
+
+      addToOutput(outputBuffer, startSampleIndex + position,
+                  samples + position, subBlockSize);
+
+      position += subBlockSize;
+    }
   }
 
 private:
-  static constexpr size_t lfoSubBlockSize = 50;
+  int currentlyPlayingNote = -1;
+  int currentMidiChannel = 0;
+  uint32_t noteOnTime = 0;
+
+  bool keyIsDown = false;
+  bool sustainPedalIsDown = false;
+  bool sostenutoPedalIsDown = false;
+
+  dsp::AudioBlock<float> scratchBlock;
+  size_t controlBlockSize = 1;
 
-  HeapBlock<char> heapBlock;
-  dsp::AudioBlock<float> tempBlock;
+  /** The envelope's samples for the current control block. */
+  std::vector<float> envelopeBuffer;
 
-  DSPParameters &parameters;
+  const Parameters *parameters;
 
   float currentVelocity = 0.0;
+  float currentVelocityLevel = 0.0;
   float currentNoteFrequency = 0.0;
   float modulationAmount = 0.0;
-  float currentDetuningAmount = *parameters.detuningAmount;
-  float currentFilterDrive = *parameters.filterDrive;
+  float currentEnvelopeLevel = 0.0;
+
+  float stereoSide = 0.0;
+  std::array<float, 2> lastChannelGains{outputGain, outputGain};
+  float currentFilterDrive = parameters->filterDrive;
+  float currentFilterCutoff = 0.0;
+  float currentFilterResonance = 0.0;
 
   float currentOsc1Frequency = 0.0;
   float currentOsc2Frequency = 0.0;
   float currentOsc2AnalogFactor = 0.0;
 
-  Waveform currentWaveform =
-      static_cast<Waveform>(static_cast<int>(*parameters.oscillatorWaveform));
+  /** Draws the analog drift of the voice's notes. */
+  Random random;
+  int64 randomSeed;
+
+  /**
+   * Maps the envelope to a factor of a parameter, which the envelope's
+   * amount moves away from 1 in either direction.
+   */
+  struct EnvelopeMapping {
+    float offset = 1;
+    float amount = 0;
+
+    explicit EnvelopeMapping(float amount = 0)
+        : offset(amount >= 0 ? 1 - amount : 1), amount(amount) {}
+
+    float operator()(float envelopeValue) const {
+      return offset + amount * envelopeValue;
+    }
+  };
+
+  EnvelopeMapping cutoffEnvelope;
+  EnvelopeMapping resonanceEnvelope;
 
   bool noteIsPlaying = false;
 
+  int maxTailSamples = 0;
+  int tailSamplesRemaining = 0;
+
   enum {
     osc1Index,
     osc2Index,
     filterIndex,
-    gainIndex,
   };
 
   dsp::ProcessorChain<VCAOscillator<float>, VCAOscillator<float>,
-                      dsp::LadderFilter<float>, dsp::Gain<float>>
+                      LadderFilter>
       processorChain;
 
   dsp::Oscillator<float> lfo;
 
-  ADSR adsr;
+  Envelope envelope;
 
 #pragma mark - Accessing Processors
 
@@ -239,33 +487,66 @@ private:
     return processorChain.get<osc2Index>();
   }
 
-  dsp::Gain<float> &gainProcessor() { return processorChain.get<gainIndex>(); }
+  LadderFilter &filter() { return processorChain.get<filterIndex>(); }
 
-  dsp::LadderFilter<float> &filter() {
-    return processorChain.get<filterIndex>();
+#pragma mark - Helper Functions
+
+  void renderControlBlock(dsp::AudioBlock<float> &subBlock) {
+    renderOscillators(subBlock);
+    processStage<filterIndex>(subBlock);
   }
 
-#pragma mark - Helper Functions
+  /**
+   * Updates the control-rate parameters, renders the oscillators and applies
+   * the envelope to them at audio rate.
+   */
+  void renderOscillators(dsp::AudioBlock<float> &subBlock) {
+    const auto numSamples = subBlock.getNumSamples();
+
+    updateSubBlockParameters(numSamples);
+
+    processOscillators(subBlock);
 
-  void renderLFOSubBlock(dsp::AudioBlock<float> &subBlock) {
+    FloatVectorOperations::multiply(subBlock.getChannelPointer(0),
+                                    envelopeBuffer.data(), (int)numSamples);
+  }
+
+  /** Renders both oscillators in one pass, when they both can. */
+  void processOscillators(dsp::AudioBlock<float> &subBlock) {
     dsp::ProcessContextReplacing<float> context(subBlock);
+    context.isBypassed = processorChain.template isBypassed<osc1Index>();
+
+    // The oscillators are always bypassed together.
+    jassert(context.isBypassed ==
+            processorChain.template isBypassed<osc2Index>());
+
+    VCAOscillator<float>::processPair(firstOscillator(), secondOscillator(),
+                                      context);
+  }
 
-    updateCurrentDSPState();
-    updateADSRParameters();
+  template <int Index> void processStage(dsp::AudioBlock<float> &subBlock) {
+    dsp::ProcessContextReplacing<float> context(subBlock);
+    context.isBypassed = processorChain.template isBypassed<Index>();
 
-    auto nextADSRSample = adsr.getNextSample();
+    processorChain.template get<Index>().process(context);
+  }
 
-    updateLevelWithADSRSample(nextADSRSample);
-    updateFilterWithADSRSample(nextADSRSample);
+  /**
+   * Renders the envelope for the next `numSamples`, and aims the filter at
+   * its level at the end of them.
+   */
+  void updateSubBlockParameters(size_t numSamples) {
+    envelope.render(envelopeBuffer.data(), numSamples);
+    currentEnvelopeLevel = envelope.getCurrentLevel();
 
-    updateModulation();
+    updateFilterWithEnvelopeLevel(currentEnvelopeLevel);
 
-    processorChain.process(context);
+    updateModulation();
   }
 
-  static float analogFactor() {
-    return (Random::getSystemRandom().nextBool() ? 1.0f : -1.0f) *
-           maxAnalogFactor * Random::getSystemRandom().nextFloat();
+  float analogFactor() {
+    return (random.nextBool() ? 1.0f : -1.0f) * maxAnalogFactor *
+           random.nextFloat();
   }
 
   static double getBendedFrequencyForWheel(int newPitchWheelValue,
@@ -290,32 +571,22 @@ private:
 
 #pragma mark - Updating DSP-Related State
 
-  void updateCurrentDSPState() {
-    if (currentWaveform !=
-        Waveform(static_cast<int>(*parameters.oscillatorWaveform))) {
-      updateOscillatorsWaveform();
-    }
-
-    if (currentDetuningAmount != *parameters.detuningAmount) {
-      updateOscillatorsFrequency();
-    }
-
-    if (currentFilterDrive != *parameters.filterDrive) {
-      updateFilterDrive();
-    }
+  void updateOscillatorsWaveform() {
+    firstOscillator().setWaveformPosition(parameters->oscillatorWaveform);
+    secondOscillator().setWaveformPosition(parameters->oscillatorWaveform);
   }
 
-  void updateOscillatorsWaveform() {
-    currentWaveform =
-        static_cast<Waveform>(static_cast<int>(*parameters.oscillatorWaveform));
+  void updateOscillatorsEngine() {
+    const auto engine = static_cast<OscillatorEngine>(
+        static_cast<int>(parameters->oscillatorEngine));
 
-    firstOscillator().setWaveform(currentWaveform);
-    secondOscillator().setWaveform(currentWaveform);
+    firstOscillator().setEngine(engine);
+    secondOscillator().setEngine(engine);
   }
 
-  void updateADSRParameters() {
-    adsr.setParameters({*parameters.attack, *parameters.decay,
-                        *parameters.sustain, *parameters.release});
+  void updateEnvelopeParameters() {
+    envelope.setParameters({parameters->attack, parameters->decay,
+                            parameters->sustain, parameters->release});
   }
 
   void updateOscillatorsFrequency() {
@@ -323,17 +594,15 @@ private:
     currentOsc2AnalogFactor = analogFactor();
     currentOsc2Frequency =
         currentNoteFrequency *
-        (1.0f + maxDetuningFactor * (*parameters.detuningAmount) *
+        (1.0f + maxDetuningFactor * parameters->detuningAmount *
                     currentOsc2AnalogFactor);
 
-    currentDetuningAmount = *parameters.detuningAmount;
-
     firstOscillator().setFrequency(currentOsc1Frequency);
     secondOscillator().setFrequency(currentOsc2Frequency);
   }
 
   void updateFilterDrive() {
-    currentFilterDrive = *parameters.filterDrive;
+    currentFilterDrive = parameters->filterDrive;
 
     filter().setDrive(currentFilterDrive);
   }
@@ -346,60 +615,91 @@ private:
                    maxAnalogFactor));
   }
 
-  void updateFilterWithADSRSample(float nextADSRSample) {
-    const auto envelopeCutoffValue =
-        *parameters.cutoffEnvelopeAmount >= 0
-            ? (1.0 - *parameters.cutoffEnvelopeAmount) +
-                  *parameters.cutoffEnvelopeAmount * nextADSRSample
-            : 1.0 + *parameters.cutoffEnvelopeAmount * nextADSRSample;
+  void updateFilterEnvelope() {
+    cutoffEnvelope = EnvelopeMapping(parameters->cutoffEnvelopeAmount);
+    resonanceEnvelope = EnvelopeMapping(parameters->resonanceEnvelopeAmount);
+  }
+
+  void updateFilterWithEnvelopeLevel(float envelopeLevel) {
+    const auto cutoff =
+        cutoffEnvelope(envelopeLevel) * (parameters->cutoff - minCutoff) +
+        minCutoff;
+    const auto resonance =
+        resonanceEnvelope(envelopeLevel) * parameters->resonance;
+
+    setFilterParameters(cutoff, resonance);
+  }
 
-    filter().setCutoffFrequencyHz(
-        envelopeCutoffValue * (*parameters.cutoff - minCutoff) + minCutoff);
+  /**
+   * Sets the parameters of the voice's filter, unless they haven't changed,
+   * e.g. while the envelope sustains.
+   */
+  void setFilterParameters(float cutoff, float resonance) {
+    if (cutoff == currentFilterCutoff && resonance == currentFilterResonance)
+      return;
 
-    const auto envelopeResonanceValue =
-        *parameters.resonanceEnvelopeAmount >= 0
-            ? (1.0 - *parameters.resonanceEnvelopeAmount) +
-                  *parameters.resonanceEnvelopeAmount * nextADSRSample
-            : 1.0 + *parameters.resonanceEnvelopeAmount * nextADSRSample;
+    currentFilterCutoff = cutoff;
+    currentFilterResonance = resonance;
 
-    filter().setResonance(envelopeResonanceValue * *parameters.resonance);
+    filter().setCutoffFrequencyHz(cutoff);
+    filter().setResonance(resonance);
   }
 
-  void updateLevelWithADSRSample(float nextADSRSample) {
-    auto envelopeVelocityValue =
-        (1.0 - (*parameters.velocityEnvelopeAmount) * (1.0 - currentVelocity)) *
-        nextADSRSample;
+  /** The envelope is applied after the oscillators, at audio rate. */
+  void updateVelocityLevel() {
+    currentVelocityLevel =
+        1.0f - parameters->velocityEnvelopeAmount * (1.0f - currentVelocity);
 
-    firstOscillator().setLevel(envelopeVelocityValue);
-    secondOscillator().setLevel(envelopeVelocityValue);
+    firstOscillator().setLevel(currentVelocityLevel);
+    secondOscillator().setLevel(currentVelocityLevel);
   }
 
 #pragma mark - Note Lifecycle
 
   void noteWillStartAttack() {
     noteIsPlaying = true;
+    tailSamplesRemaining = maxTailSamples;
+
+    lastChannelGains = stereoChannelGains();
+  }
 
-    stopTimer();
+  /** Returns the voice to the synth's pool right away. */
+  void noteDidFade() {
+    noteIsPlaying = false;
+    clearCurrentNote();
   }
 
-  void noteDidFade() { startTimer(1000); }
+  void clearCurrentNote() {
+    currentlyPlayingNote = -1;
+    currentMidiChannel = 0;
+  }
 
-#pragma mark - Bypassing processing
+  /**
+   * Once the envelope has finished, lets the filter ring until its output
+   * is silent, or for `maxTailDurationSeconds` at most, and then releases
+   * the voice. Counting samples rather than time keeps offline renders
+   * deterministic.
+   */
+  void updateNoteLifecycle(const float *output, size_t numSamples) {
+    if (!noteIsPlaying || envelope.isActive())
+      return;
 
-  void setProcessorsBypassed(bool bypassed) {
-    processorChain.template setBypassed<osc1Index>(bypassed);
-    processorChain.template setBypassed<osc2Index>(bypassed);
+    tailSamplesRemaining -= (int)numSamples;
 
-    filter().setEnabled(!bypassed);
-  }
+    const auto range =
+        FloatVectorOperations::findMinAndMax(output, (int)numSamples);
+    const auto isSilent =
+        jmax(-range.getStart(), range.getEnd()) < silenceThreshold;
 
-#pragma mark - Timer
+    if (isSilent || tailSamplesRemaining <= 0)
+      noteDidFade();
+  }
 
-  /** Timer callback is called some time after note tails off. */
-  void timerCallback() override {
-    stopTimer();
+#pragma mark - Bypassing processing
 
-    noteIsPlaying = false;
-    clearCurrentNote();
+  void setProcessorsBypassed(bool bypassed) {
+    processorChain.template setBypassed<osc1Index>(bypassed);
+    processorChain.template setBypassed<osc2Index>(bypassed);
+    processorChain.template setBypassed<filterIndex>(bypassed);
   }
 };
@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+    Wavetable.h
+    Created: 18 Oct 2026 4:27:52pm
+    Author:  Dmitry Khrykin
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "MultibandLookupTable.h"
+#include <juce_audio_formats/juce_audio_formats.h>
+
+using namespace juce;
+
+/**
+ * User wavetable, imported from a WAV file.
+ *
+ * A file holds either a single cycle, or a sequence of equally long cycles
+ * (frames) that the oscillator can morph through. Every frame is resampled to
+ * the given table resolution and kept as a spectrum, from which
+ * `MultibandLookupTable` builds the band-limited octave tables.
+ *
+ * The frame length is read from the file's `clm ` chunk, which Serum and most
+ * wavetable editors write. Files without one are multi-frame only if their
+ * length is an exact multiple of the table resolution, i.e. they hold
+ * `numberOfFrames * tableResolution` samples. Any other file is a single
+ * cycle.
+ */
+template <typename FloatType> class Wavetable {
+public:
+  using Spectrum = typename MultibandLookupTable<FloatType>::Spectrum;
+
+  static constexpr auto maxNumberOfFrames = 256;
+  static constexpr auto maxLength = 1 << 19;
+
+  /** Files longer than this can't be a single cycle. */
+  static constexpr auto maxSingleCycleSize = 1 << 16;
+
+#pragma mark - Loading
+
+  /** Returns false if the file can't be read or isn't a wavetable. */
+  bool loadFromFile(const File &file, int tableResolution) {
+    auto stream = file.createInputStream();
+    if (stream == nullptr)
+      return false;
+
+    WavAudioFormat format;
+    std::unique_ptr<AudioFormatReader> reader(
+        format.createReaderFor(stream.release(), true));
+
+    if (reader == nullptr || reader->lengthInSamples < 2 ||
+        reader->lengthInSamples > maxLength)
+      return false;
+
+    const auto length = (int)reader->lengthInSamples;
+
+    auto frameLength = readDeclaredFrameLength(file);
+    if (frameLength < 2 || length % frameLength != 0)
+      frameLength = length % tableResolution == 0 ? tableResolution : length;
+
+    if ((frameLength == length && length > maxSingleCycleSize) ||
+        length / frameLength > maxNumberOfFrames)
+      return false;
+
+    AudioBuffer<float> buffer(1, length);
+    reader->read(&buffer, 0, length, 0, true, false);
+
+    const auto peak = buffer.getMagnitude(0, 0, length);
+    if (peak == 0)
+      return false;
+
+    spectra.clear();
+
+    for (auto start = 0; start < length; start += frameLength) {
+      spectra.push_back(analyzeFrame(buffer.getReadPointer(0, start),
+                                     frameLength, tableResolution, 1 / peak));
+    }
+
+    return true;
+  }
+
+#pragma mark - Getting Frames
+
+  int getNumFrames() const { return (int)spectra.size(); }
+
+  /** Returns the spectra of all frames, in the table's units. */
+  const std::vector<Spectrum> &getSpectra() const { return spectra; }
+
+private:
+  std::vector<Spectrum> spectra;
+
+#pragma mark - Reading Metadata
+
+  /**
+   * Returns the frame length that the file's `clm ` chunk declares, e.g.
+   * "<!>2048 ...", or 0 if it has none.
+   */
+  static int readDeclaredFrameLength(const File &file) {
+    FileInputStream stream(file);
+
+    char id[4];
+    if (!stream.openedOk() || stream.read(id, 4) != 4 ||
+        std::memcmp(id, "RIFF", 4) != 0)
+      return 0;
+
+    stream.readInt();
+
+    if (stream.read(id, 4) != 4 || std::memcmp(id, "WAVE", 4) != 0)
+      return 0;
+
+    while (stream.read(id, 4) == 4) {
+      const auto chunkSize = (int64)(uint32)stream.readInt();
+      const auto nextChunk =
+          stream.getPosition() + chunkSize + (chunkSize & 1);
+
+      if (std::memcmp(id, "clm ", 4) == 0) {
+        MemoryBlock chunk;
+        stream.readIntoMemoryBlock(chunk, (ssize_t)jmin(chunkSize, (int64)64));
+
+        const auto text = String::fromUTF8(
+            static_cast<const char *>(chunk.getData()), (int)chunk.getSize());
+
+        return text.startsWith("<!>") ? text.substring(3).getIntValue() : 0;
+      }
+
+      if (!stream.setPosition(nextChunk))
+        break;
+    }
+
+    return 0;
+  }
+
+#pragma mark - Analyzing Frames
+
+  /**
+   * Resamples the frame to the nearest power of two length with linear
+   * interpolation, and returns the partials that fit the table resolution.
+   */
+  static Spectrum analyzeFrame(const float *frame, int frameLength,
+                               int tableResolution, float gain) {
+    const auto fftOrder =
+        jmax(1, (int)std::ceil(std::log2((double)frameLength)));
+    const auto fftSize = 1 << fftOrder;
+
+    std::vector<float> fftData((size_t)(2 * fftSize));
+
+    for (auto i = 0; i < fftSize; i++) {
+      const auto position = (double)i * frameLength / fftSize;
+      const auto index = (int)position;
+      const auto fraction = (float)(position - index);
+      const auto current = frame[index];
+      const auto next = frame[(index + 1) % frameLength];
+
+      fftData[(size_t)i] = gain * (current + fraction * (next - current));
+    }
+
+    dsp::FFT(fftOrder).performRealOnlyForwardTransform(fftData.data());
+
+    const auto numberOfHarmonics = jmin(fftSize, tableResolution) / 2 - 1;
+
+    Spectrum spectrum((size_t)numberOfHarmonics + 1);
+
+    // The bin (a - i * b) * N / 2 holds the partial a * cos + b * sin.
+    for (auto harmonic = 1; harmonic <= numberOfHarmonics; harmonic++) {
+      spectrum[(size_t)harmonic] = {
+          FloatType(2) / fftSize * fftData[(size_t)(2 * harmonic)],
+          -FloatType(2) / fftSize * fftData[(size_t)(2 * harmonic + 1)]};
+    }
+
+    return spectrum;
+  }
+};
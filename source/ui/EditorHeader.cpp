@@ -62,7 +62,7 @@ EditorHeader::EditorHeader(BlackBirdAudioProcessorEditor &editor)
 
     if (fc.browseForFileToSave(true)) {
       MemoryBlock data;
-      editor.processor.getStateInformation(data);
+      editor.processor.getPresetInformation(data);
 
       auto file = fc.getResult();
       if (!file.replaceWithData(data.getData(), data.getSize())) {
@@ -82,6 +82,23 @@ EditorHeader::EditorHeader(BlackBirdAudioProcessorEditor &editor)
 
   savePresetButton.setColour(TextButton::textColourOffId,
                              Colour(200, 200, 200));
+
+  wavetableButton.onClick = [this] { showWavetableMenu(); };
+  wavetableButton.setColour(TextButton::textColourOffId,
+                            Colour(200, 200, 200));
+
+  addAndMakeVisible(wavetableButton);
+
+  channelsButton.onClick = [this] { showChannelsMenu(); };
+  channelsButton.setColour(TextButton::textColourOffId,
+                           Colour(200, 200, 200));
+
+  addAndMakeVisible(channelsButton);
+
+  threadsButton.onClick = [this] { showThreadsMenu(); };
+  threadsButton.setColour(TextButton::textColourOffId, Colour(200, 200, 200));
+
+  addAndMakeVisible(threadsButton);
 }
 
 EditorHeader::~EditorHeader() { setLookAndFeel(nullptr); }
@@ -106,8 +123,110 @@ void EditorHeader::resized() {
 
   savePresetButton.setBounds(presetButtonRect.withWidth(50));
 
+  presetButtonRect.setX(savePresetButton.getRight() + (int)editor.padding);
+  wavetableButton.setBounds(presetButtonRect.withWidth(80));
+
+  presetButtonRect.setX(wavetableButton.getRight() + (int)editor.padding);
+  threadsButton.setBounds(presetButtonRect.withWidth(80));
+
   presetButtonRect.setX(presetsComboRect.getX() - 30);
   previousPresetButton.setBounds(presetButtonRect);
+
+  presetButtonRect.setX(previousPresetButton.getX() - (int)editor.padding - 80);
+  channelsButton.setBounds(presetButtonRect.withWidth(80));
+}
+
+void EditorHeader::showWavetableMenu() {
+  enum { importItemId = 1, builtInItemId };
+
+  PopupMenu menu;
+  menu.addItem(importItemId, "Import Wavetable...");
+  menu.addItem(builtInItemId, "Built-in Waveforms", true,
+               editor.processor.synth().getUserWavetable() == File());
+
+  menu.showMenuAsync(
+      PopupMenu::Options().withTargetComponent(wavetableButton),
+      [this](int itemId) {
+        if (itemId == builtInItemId) {
+          editor.processor.clearWavetable();
+          return;
+        }
+
+        if (itemId != importItemId)
+          return;
+
+        FileChooser fc(("Import wavetable"), File(), "*.wav");
+
+        if (fc.browseForFileToOpen() &&
+            !editor.processor.importWavetable(fc.getResult())) {
+          AlertWindow::showMessageBoxAsync(
+              AlertWindow::WarningIcon, TRANS("Error whilst importing"),
+              TRANS("Couldn't read a wavetable from the specified file!"));
+        }
+      });
+}
+
+void EditorHeader::showChannelsMenu() {
+  // Item ids encode the channel and the preset's index, from 1, or 0 for the
+  // plugin's parameters.
+  constexpr auto itemsPerChannel = 1000;
+
+  const auto presetsNames = editor.processor.getPresetsNames();
+
+  PopupMenu menu;
+
+  for (auto midiChannel = 1; midiChannel <= Synth::numberOfMidiChannels;
+       midiChannel++) {
+    const auto channelPreset = editor.processor.getChannelPreset(midiChannel);
+    const auto firstItemId = midiChannel * itemsPerChannel;
+
+    PopupMenu channelMenu;
+    channelMenu.addItem(firstItemId, "Plugin Parameters", true,
+                        channelPreset.isEmpty());
+    channelMenu.addSeparator();
+
+    for (auto i = 0; i < jmin(presetsNames.size(), itemsPerChannel - 1); i++)
+      channelMenu.addItem(firstItemId + i + 1, presetsNames[i], true,
+                          presetsNames[i] == channelPreset);
+
+    const auto channelName =
+        "Channel " + String(midiChannel) +
+        (channelPreset.isEmpty() ? String() : ": " + channelPreset);
+
+    menu.addSubMenu(channelName, channelMenu);
+  }
+
+  menu.showMenuAsync(
+      PopupMenu::Options().withTargetComponent(channelsButton),
+      [this, presetsNames](int itemId) {
+        if (itemId < itemsPerChannel)
+          return;
+
+        const auto presetIndex = itemId % itemsPerChannel - 1;
+        editor.processor.setChannelPreset(itemId / itemsPerChannel,
+                                          presetsNames[presetIndex]);
+      });
+}
+
+void EditorHeader::showThreadsMenu() {
+  // Item ids are the number of threads, from 1.
+  const auto numberOfThreads = editor.processor.getNumberOfRenderThreads();
+
+  PopupMenu menu;
+  menu.addItem(1, "Audio Thread Only", true, numberOfThreads == 0);
+  menu.addSeparator();
+
+  for (auto i = 1;
+       i <= BlackBirdAudioProcessor::getMaxNumberOfRenderThreads(); i++)
+    menu.addItem(i + 1,
+                 String(i) + (i == 1 ? " Worker Thread" : " Worker Threads"),
+                 true, numberOfThreads == i);
+
+  menu.showMenuAsync(PopupMenu::Options().withTargetComponent(threadsButton),
+                     [this](int itemId) {
+                       if (itemId > 0)
+                         editor.processor.setNumberOfRenderThreads(itemId - 1);
+                     });
 }
 
 void EditorHeader::updatePresetsList(const String &newSelectedPreset) {
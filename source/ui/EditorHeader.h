@@ -37,10 +37,16 @@ private:
   TextButton nextPresetButton{">"};
   TextButton previousPresetButton{"<"};
   TextButton savePresetButton{"Save"};
+  TextButton wavetableButton{"Wavetable"};
+  TextButton channelsButton{"Channels"};
+  TextButton threadsButton{"Threads"};
 
   HeaderLookAndFeel lookAndFeel;
 
   void updatePresetsList(const String &newSelectedPreset);
+  void showWavetableMenu();
+  void showChannelsMenu();
+  void showThreadsMenu();
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EditorHeader)
 };
@@ -47,7 +47,7 @@ void KnobLookAndFeel::drawRotarySlider(Graphics &g, int x, int y, int width,
     for (auto i = 0; i < numberOfLines; i++) {
       auto lineAngle = rotaryStartAngle + i * linesAngleIncrement;
       auto percentage = (float)i / (numberOfLines - 1.0f);
-      auto isHighlighted = sliderPos == percentage;
+      auto isHighlighted = roundToInt(sliderPos * (numberOfLines - 1)) == i;
 
       Path line;
       line.addLineSegment({0.0f, 0.0f, 0.0f, lineLength}, 0.0f);
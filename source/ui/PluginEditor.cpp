@@ -20,7 +20,7 @@ BlackBirdAudioProcessorEditor::BlackBirdAudioProcessorEditor(
 
   addAndMakeVisible(header);
 
-  setSize(8.0f * masterSection.recommendedWidth() + 1.0f * padding +
+  setSize(9.0f * oscillatorSection.recommendedWidth() + 1.0f * padding +
               3.0f * 0.5f * padding,
           masterSection.recommendedHeight() + headerHeight + 2.0f * padding);
 }
@@ -58,6 +58,9 @@ void BlackBirdAudioProcessorEditor::setupControls() {
   addAndMakeVisible(masterSection);
   addParameterAsKnobToSection(masterSection, reverbParameterID, "Reverb");
   addParameterAsKnobToSection(masterSection, masterGainParameterID, "Gain");
+  addParameterAsKnobToSection(masterSection, stereoSpreadParameterID,
+                              "Spread");
+  addParameterAsKnobToSection(masterSection, polyphonyParameterID, "Voices");
 }
 
 Knob *BlackBirdAudioProcessorEditor::addParameterAsKnobToSection(
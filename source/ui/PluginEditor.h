@@ -40,7 +40,7 @@ private:
   Section oscillatorSection{"Oscillator"};
   Section filterSection{"Filter", 2};
   Section envelopeSection{"Envelope", 4};
-  Section masterSection{"Master"};
+  Section masterSection{"Master", 2};
 
   EditorHeader header{*this};
 